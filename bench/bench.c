@@ -0,0 +1,62 @@
+#include "bench.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// Host benchmarks for the terminal core. Run without arguments to run every
+// benchmark, or name one followed by its own arguments.
+
+static const struct bench benches[] = {
+    {"stream", "byte stream throughput of terminal_uart_receive_character",
+     bench_stream},
+    {"glyph", "glyph rasterisation rate of screen_draw_codepoint and _run", bench_glyph},
+    {"scroll", "line feed cost by scrolling region height", bench_scroll},
+    {"font", "glyph lookup rate of find_glyph by codepoint mix", bench_font},
+    {"flow", "simulated flow control throughput and stop/start rate",
+     bench_flow},
+    {"utf8", "UTF-8 decoding of malformed input and decode throughput",
+     bench_utf8},
+    {"latency", "worst case time per receive chunk and per flush",
+     bench_latency},
+    {"scheduler", "scheduler checks and keyboard latency under load",
+     bench_scheduler},
+    {"ring", "SPSC ring ordering and throughput with a producer thread",
+     bench_ring},
+    {NULL},
+};
+
+uint64_t bench_now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void usage(const char *name) {
+  fprintf(stderr, "usage: %s [benchmark [args...]]\n\n", name);
+
+  for (const struct bench *bench = benches; bench->name; bench++)
+    fprintf(stderr, "  %-12s %s\n", bench->name, bench->description);
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    int result = 0;
+
+    for (const struct bench *bench = benches; bench->name; bench++) {
+      printf("== %s ==\n", bench->name);
+      result |= bench->run(0, NULL);
+      printf("\n");
+    }
+
+    return result;
+  }
+
+  for (const struct bench *bench = benches; bench->name; bench++)
+    if (strcmp(argv[1], bench->name) == 0)
+      return bench->run(argc - 2, argv + 2);
+
+  usage(argv[0]);
+  return 1;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct bench {
+  const char *name;
+  const char *description;
+  int (*run)(int argc, char **argv);
+};
+
+uint64_t bench_now_ns();
+
+int bench_stream(int argc, char **argv);
+
+int bench_glyph(int argc, char **argv);
+
+int bench_scroll(int argc, char **argv);
+
+int bench_font(int argc, char **argv);
+
+int bench_ring(int argc, char **argv);
+
+int bench_flow(int argc, char **argv);
+
+int bench_utf8(int argc, char **argv);
+
+int bench_latency(int argc, char **argv);
+
+int bench_scheduler(int argc, char **argv);
@@ -0,0 +1,210 @@
+#include "bench.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "host/host.h"
+#include "null_callbacks.h"
+#include "terminal/terminal_internal.h"
+
+// Simulates a host streaming into the receive buffer at the line rate while
+// the main loop drains it at a given rate, a millisecond at a time, and
+// compares the adaptive flow control limits with the fixed ones they
+// replaced. The host only reacts to XOFF and XON after a delay. Reports the
+// throughput reached against the line rate, how often the host was stopped, how long the buffer sat empty while it was
+// stopped and how many bytes overflowed, which must be none.
+
+#define SIMULATED_MS 20000
+
+#define RECEIVE_BUFFER_SIZE 8192
+#define CHUNK_SIZE 64
+
+// How long the simulated host takes to react, within what the terminal
+// allows for.
+#define HOST_LATENCY_MS 15
+
+// The limits used before they were derived from the line and drain rates.
+#define FIXED_XOFF_LIMIT 256
+#define FIXED_XON_LIMIT 128
+
+struct drain_pattern {
+  const char *name;
+  // Drain rate as a fraction of the line rate, alternating every period.
+  double fast;
+  double slow;
+  uint32_t period_ms;
+};
+
+static const struct drain_pattern patterns[] = {
+    {"steady x2", 2.0, 2.0, 0},
+    {"steady x0.5", 0.5, 0.5, 0},
+    {"bursty", 2.0, 0.1, 150},
+    {NULL},
+};
+
+static const uint32_t bauds[] = {115200, 921600};
+
+static struct visual_cell cells[TERMINAL_MAX_ROWS * TERMINAL_MAX_COLS];
+static uint8_t tab_stops[TERMINAL_MAX_COLS / 8];
+
+// Time at which the host last asked to stop or start; the simulated host
+// follows HOST_LATENCY_MS later.
+static uint32_t now_ms;
+static bool requested_stop;
+static uint32_t requested_at_ms;
+static size_t stops;
+
+static void request(bool stop) {
+  if (stop && !requested_stop)
+    stops++;
+
+  requested_stop = stop;
+  requested_at_ms = now_ms;
+}
+
+static bool flow_transmit(const character_t *characters, size_t size) {
+  for (size_t i = 0; i < size; i++)
+    if (characters[i] == CHAR_XOFF || characters[i] == CHAR_XON)
+      request(characters[i] == CHAR_XOFF);
+
+  return true;
+}
+
+static void flow_set_rts(bool ready) { request(!ready); }
+
+// The null callbacks, but passing flow control on to the simulated host.
+static struct terminal_callbacks flow_callbacks;
+
+static void fixed_flow_control(size_t receive_size) {
+  if (receive_size > FIXED_XOFF_LIMIT && !requested_stop)
+    request(true);
+
+  if (receive_size < FIXED_XON_LIMIT && requested_stop)
+    request(false);
+}
+
+struct result {
+  double throughput;
+  size_t stops;
+  uint32_t starved_ms;
+  uint64_t overflow;
+};
+
+static struct result simulate(struct terminal *terminal, uint32_t baud,
+                              const struct drain_pattern *pattern,
+                              bool adaptive) {
+  double line_rate = baud / 10 / 1000.0;
+  double arriving = 0, draining = 0;
+  size_t size = 0;
+  uint64_t consumed = 0;
+  struct result result = {0};
+
+  stops = 0;
+  requested_stop = false;
+  requested_at_ms = 0;
+
+  for (now_ms = 0; now_ms < SIMULATED_MS; now_ms++) {
+    bool fast = !pattern->period_ms || (now_ms / pattern->period_ms) % 2 == 0;
+    double drain_rate = line_rate * (fast ? pattern->fast : pattern->slow);
+
+    bool host_stopped = requested_stop
+                            ? now_ms >= requested_at_ms + HOST_LATENCY_MS
+                            : now_ms < requested_at_ms + HOST_LATENCY_MS &&
+                                  requested_at_ms != 0;
+
+    if (!host_stopped) {
+      arriving += line_rate;
+      size_t arrived = (size_t)arriving;
+      arriving -= arrived;
+
+      if (size + arrived > RECEIVE_BUFFER_SIZE) {
+        result.overflow += size + arrived - RECEIVE_BUFFER_SIZE;
+        arrived = RECEIVE_BUFFER_SIZE - size;
+      }
+
+      size += arrived;
+    }
+
+    if (!size && host_stopped)
+      result.starved_ms++;
+
+    // The main loop: check once, then after every chunk it hands over.
+    draining += drain_rate;
+
+    if (adaptive)
+      terminal_uart_flow_control(terminal, size);
+    else
+      fixed_flow_control(size);
+
+    while (size && draining >= 1) {
+      size_t chunk = size < CHUNK_SIZE ? size : CHUNK_SIZE;
+      if (chunk > draining)
+        chunk = (size_t)draining;
+
+      size -= chunk;
+      draining -= chunk;
+      consumed += chunk;
+
+      if (adaptive)
+        terminal_uart_flow_control(terminal, size);
+      else
+        fixed_flow_control(size);
+    }
+
+    if (!size && draining > CHUNK_SIZE)
+      draining = CHUNK_SIZE;
+
+    terminal_timer_tick(terminal);
+  }
+
+  result.throughput = consumed * 1000.0 / SIMULATED_MS;
+  result.stops = stops;
+
+  return result;
+}
+
+int bench_flow(int argc, char **argv) {
+  flow_callbacks = null_callbacks;
+  flow_callbacks.uart_transmit = flow_transmit;
+  flow_callbacks.uart_set_rts = flow_set_rts;
+
+  struct terminal_config config;
+  host_default_config(&config);
+  bool ok = true;
+
+  printf("%-8s %-12s %-9s %12s %7s %8s %9s %9s\n", "baud", "drain",
+         "limits", "bytes/s", "of line", "stops/s", "starved", "overflow");
+
+  for (size_t b = 0; b < sizeof(bauds) / sizeof(bauds[0]); b++) {
+    config.baud_rate =
+        bauds[b] == 921600 ? BAUD_RATE_921600 : BAUD_RATE_115200;
+
+    for (const struct drain_pattern *pattern = patterns; pattern->name;
+         pattern++) {
+      for (int adaptive = 0; adaptive < 2; adaptive++) {
+        struct terminal terminal;
+        terminal_init(&terminal, &flow_callbacks, cells,
+#ifdef TERMINAL_ALT_CELLS
+                      NULL,
+#endif
+                      tab_stops, sizeof(tab_stops), &config);
+        terminal_uart_set_receive_buffer_size(&terminal, RECEIVE_BUFFER_SIZE);
+
+        struct result result = simulate(&terminal, bauds[b], pattern, adaptive);
+
+        printf("%-8u %-12s %-9s %12.0f %6.1f%% %8.1f %7ums %9llu\n",
+               bauds[b], pattern->name, adaptive ? "adaptive" : "fixed",
+               result.throughput, result.throughput * 1000 / bauds[b],
+               result.stops * 1000.0 / SIMULATED_MS, result.starved_ms,
+               (unsigned long long)result.overflow);
+
+        if (adaptive && result.overflow) {
+          printf("MISMATCH: adaptive flow control let the buffer overflow\n");
+          ok = false;
+        }
+      }
+    }
+  }
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,140 @@
+#include "bench.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "fonts/font.h"
+
+// Looks up glyphs for several codepoint mixes with find_glyph and with a copy
+// of the original binary search over the sorted codepoints, falling back to a
+// second search for the replacement glyph, checks that both agree for every
+// BMP codepoint and reports lookups per second for each, along with how often
+// the SRAM residency layer had the glyph.
+
+#define MIN_DURATION_NS 250000000ULL
+
+#define MIX_SIZE 4096
+
+#define REPLACEMENT_CODEPOINT 32
+
+static int16_t reference_find_glyph_index(const struct bitmap_font *font,
+                                          uint16_t codepoint) {
+  size_t first = 0;
+  size_t last = font->codepoints_length - 1;
+  size_t middle = (first + last) / 2;
+
+  while (first <= last) {
+    if (font->codepoints[middle] == codepoint)
+      return middle;
+
+    if (font->codepoints[middle] < codepoint)
+      first = middle + 1;
+    else
+      last = middle - 1;
+
+    middle = (first + last) / 2;
+  }
+
+  return -1;
+}
+
+static const uint8_t *reference_find_glyph(const struct bitmap_font *font,
+                                           uint16_t codepoint) {
+  if (codepoint == 0)
+    codepoint = 32;
+
+  int16_t index = reference_find_glyph_index(font, codepoint);
+  if (index == -1)
+    index = reference_find_glyph_index(font, REPLACEMENT_CODEPOINT);
+
+  return font->data + (index * font->height);
+}
+
+struct mix {
+  const char *name;
+  uint16_t first;
+  uint16_t last;
+};
+
+static const struct mix mixes[] = {
+    {"ascii", 0x20, 0x7e},
+    {"latin-1", 0xa0, 0xff},
+    {"box", 0x2500, 0x257f},
+    {"cyrillic", 0x0410, 0x044f},
+    {"random", 0x0000, 0xffff},
+    {NULL},
+};
+
+static void fill_mix(uint16_t *codepoints, const struct mix *mix) {
+  uint32_t state = 1;
+  uint32_t range = mix->last - mix->first + 1;
+
+  for (size_t i = 0; i < MIX_SIZE; i++) {
+    state = state * 1103515245 + 12345;
+    codepoints[i] = mix->first + (state >> 8) % range;
+  }
+}
+
+static double measure(const uint8_t *(*find)(const struct bitmap_font *,
+                                             uint16_t),
+                      const uint16_t *codepoints) {
+  size_t lookups = 0;
+  uintptr_t sink = 0;
+  uint64_t start = bench_now_ns();
+  uint64_t elapsed = 0;
+
+  do {
+    for (size_t i = 0; i < MIX_SIZE; i++)
+      sink += (uintptr_t)find(&normal_font, codepoints[i]);
+
+    lookups += MIX_SIZE;
+    elapsed = bench_now_ns() - start;
+  } while (elapsed < MIN_DURATION_NS);
+
+  // Keeps the lookups from being optimised away.
+  if (sink == 1)
+    printf("\n");
+
+  return lookups * 1e9 / elapsed;
+}
+
+int bench_font(int argc, char **argv) {
+  const struct bitmap_font *fonts[] = {&normal_font, &bold_font};
+
+  for (size_t f = 0; f < 2; f++) {
+    font_residency_init(fonts[f]);
+
+    for (uint32_t codepoint = 0; codepoint < 0x10000; codepoint++)
+      if (memcmp(find_glyph(fonts[f], codepoint),
+                 reference_find_glyph(fonts[f], codepoint),
+                 fonts[f]->height) != 0) {
+        printf("MISMATCH: find_glyph differs from reference for U+%04x\n",
+               codepoint);
+        return 1;
+      }
+  }
+
+  printf("%-8s %14s %14s %8s %9s %9s %9s\n", "mix", "search/s", "table/s",
+         "speedup", "resident", "slot", "miss");
+
+  for (const struct mix *mix = mixes; mix->name; mix++) {
+    uint16_t codepoints[MIX_SIZE];
+    fill_mix(codepoints, mix);
+
+    double reference = measure(reference_find_glyph, codepoints);
+
+    font_residency_init(&normal_font);
+    double table = measure(find_glyph, codepoints);
+
+    struct glyph_residency_stats stats;
+    font_residency_get_stats(&normal_font, &stats);
+    double lookups = stats.resident_hits + stats.slot_hits + stats.misses;
+
+    printf("%-8s %14.0f %14.0f %7.2fx %8.1f%% %8.1f%% %8.1f%%\n", mix->name,
+           reference, table, table / reference,
+           stats.resident_hits * 100.0 / lookups,
+           stats.slot_hits * 100.0 / lookups, stats.misses * 100.0 / lookups);
+  }
+
+  return 0;
+}
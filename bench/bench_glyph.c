@@ -0,0 +1,244 @@
+#include "bench.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "crt/crt.h"
+#include "fonts/font.h"
+#include "terminal/screen.h"
+
+// Draws glyphs across the whole 24 row screen with screen_draw_codepoint, with
+// screen_draw_run over runs of identically styled cells and with a copy of the
+// original byte-at-a-time setSixBitsAt renderer, checks that all of them leave
+// the same frame and reports glyphs per second for each. The renderers take
+// turns over a few rounds and each keeps its best, so that a slow stretch of
+// the machine does not land on one of them only.
+
+#define MIN_DURATION_NS 100000000ULL
+#define ROUNDS 5
+
+#define ROWS 24
+#define COLS 80
+
+#define CHAR_WIDTH_PIXELS 6
+#define CHAR_HEIGHT_LINES 11
+#define SCREEN_WIDTH_BYTES 64
+#define X_MARGIN 16
+#define Y_MARGIN 39
+
+static uint32_t frame[VIDEO_BUFFER_SIZE / 4];
+static uint32_t reference_frame[VIDEO_BUFFER_SIZE / 4];
+
+static struct screen screen = {
+    .format =
+        {
+            .rows = ROWS,
+            .cols = COLS,
+        },
+    .char_width = CHAR_WIDTH_PIXELS,
+    .char_height = CHAR_HEIGHT_LINES,
+    .buffer = NULL,
+    .normal_bitmap_font = &normal_font,
+    .bold_bitmap_font = &bold_font,
+};
+
+static void reference_set_six_bits(uint8_t *buffer, uint8_t sixBits, int row,
+                                   int col, int line) {
+  int x = X_MARGIN + col * CHAR_WIDTH_PIXELS;
+  int y = Y_MARGIN + row * CHAR_HEIGHT_LINES + line;
+
+  sixBits &= 0b00111111;
+
+  int xByte = x / 8;
+  int xOffset = x % 8;
+
+  uint8_t current = buffer[y * SCREEN_WIDTH_BYTES + xByte];
+  buffer[y * SCREEN_WIDTH_BYTES + xByte] =
+      (((sixBits << 2) >> xOffset) + (current & ~(0b11111100 >> xOffset)));
+
+  if (xOffset > 2) {
+    current = buffer[y * SCREEN_WIDTH_BYTES + xByte + 1];
+    buffer[y * SCREEN_WIDTH_BYTES + xByte + 1] =
+        ((sixBits << (10 - xOffset)) +
+         (current & (0b11111111 >> (xOffset - 2))));
+  }
+}
+
+static void reference_draw_codepoint(uint8_t *buffer, size_t row, size_t col,
+                                     codepoint_t codepoint, enum font font,
+                                     bool underlined, color_t active,
+                                     color_t inactive) {
+  const struct bitmap_font *bitmap_font =
+      font == FONT_BOLD ? &bold_font : &normal_font;
+
+  const unsigned char *glyph = find_glyph(bitmap_font, codepoint);
+  if (!glyph)
+    glyph = find_glyph(bitmap_font, ' ');
+
+  for (size_t char_line = 0; char_line < CHAR_HEIGHT_LINES; char_line++) {
+    uint8_t pixels = inactive == DEFAULT_ACTIVE_COLOR ? 0xff : 0;
+
+    if (glyph) {
+      if (char_line < bitmap_font->height)
+        pixels = active == DEFAULT_ACTIVE_COLOR ? glyph[char_line]
+                                                : ~glyph[char_line];
+
+      if (underlined && char_line == CHAR_HEIGHT_LINES - 1)
+        pixels ^= active == DEFAULT_ACTIVE_COLOR ? 0xff : 0;
+    }
+
+    reference_set_six_bits(buffer, pixels, row, col, char_line);
+  }
+}
+
+// Cycles through printable ASCII, normal and bold, plain, underlined and
+// inverse. Styles change every few dozen cells, roughly like a TUI screen, and
+// the boundaries move by a cell every pass so that every cell phase is hit.
+static void cell_attributes(size_t i, codepoint_t *codepoint, enum font *font,
+                            bool *underlined, color_t *active,
+                            color_t *inactive) {
+  *codepoint = 0x21 + i % 94;
+  *font = (i / 40) % 2 ? FONT_BOLD : FONT_NORMAL;
+  *underlined = (i / 60) % 3 == 0;
+
+  bool negative = (i / 50) % 2;
+  *active = negative ? DEFAULT_INACTIVE_COLOR : DEFAULT_ACTIVE_COLOR;
+  *inactive = negative ? DEFAULT_ACTIVE_COLOR : DEFAULT_INACTIVE_COLOR;
+}
+
+static void draw_screen(size_t pass) {
+  for (size_t row = 0; row < ROWS; row++)
+    for (size_t col = 0; col < COLS; col++) {
+      codepoint_t codepoint;
+      enum font font;
+      bool underlined;
+      color_t active, inactive;
+
+      cell_attributes(pass + row * COLS + col, &codepoint, &font, &underlined,
+                      &active, &inactive);
+      screen_draw_codepoint(&screen, row, col, codepoint, font, false,
+                            underlined, false, active, inactive);
+    }
+}
+
+static void draw_screen_runs(size_t pass) {
+  for (size_t row = 0; row < ROWS; row++) {
+    size_t col = 0;
+
+    while (col < COLS) {
+      codepoint_t codepoints[COLS];
+      enum font font;
+      bool underlined;
+      color_t active, inactive;
+
+      cell_attributes(pass + row * COLS + col, &codepoints[0], &font,
+                      &underlined, &active, &inactive);
+
+      size_t count = 1;
+      while (col + count < COLS) {
+        enum font next_font;
+        bool next_underlined;
+        color_t next_active, next_inactive;
+
+        cell_attributes(pass + row * COLS + col + count, &codepoints[count],
+                        &next_font, &next_underlined, &next_active,
+                        &next_inactive);
+
+        if (next_font != font || next_underlined != underlined ||
+            next_active != active)
+          break;
+
+        count++;
+      }
+
+      screen_draw_run(&screen, row, col, codepoints, count, font, false,
+                      underlined, false, active, inactive);
+      col += count;
+    }
+  }
+}
+
+static void reference_draw_screen(size_t pass) {
+  for (size_t row = 0; row < ROWS; row++)
+    for (size_t col = 0; col < COLS; col++) {
+      codepoint_t codepoint;
+      enum font font;
+      bool underlined;
+      color_t active, inactive;
+
+      cell_attributes(pass + row * COLS + col, &codepoint, &font, &underlined,
+                      &active, &inactive);
+      reference_draw_codepoint((uint8_t *)reference_frame, row, col, codepoint,
+                               font, underlined, active, inactive);
+    }
+}
+
+static double measure(void (*draw)(size_t)) {
+  size_t glyphs = 0;
+  uint64_t start = bench_now_ns();
+  uint64_t elapsed = 0;
+
+  for (size_t pass = 0; elapsed < MIN_DURATION_NS; pass++) {
+    draw(pass);
+
+    glyphs += ROWS * COLS;
+    elapsed = bench_now_ns() - start;
+  }
+
+  return glyphs * 1e9 / elapsed;
+}
+
+int bench_glyph(int argc, char **argv) {
+  screen.buffer = (uint8_t *)frame;
+  font_residency_init(&normal_font);
+  font_residency_init(&bold_font);
+
+  for (size_t pass = 0; pass < 120; pass++) {
+    reference_draw_screen(pass);
+
+    draw_screen(pass);
+    if (memcmp(frame, reference_frame, VIDEO_BUFFER_SIZE) != 0) {
+      printf("MISMATCH: screen_draw_codepoint differs from reference on pass "
+             "%zu\n",
+             pass);
+      return 1;
+    }
+
+    // Start from a frame shifted by a few glyphs so that stale pixels around
+    // every run would show up.
+    draw_screen(pass + 7);
+    draw_screen_runs(pass);
+    if (memcmp(frame, reference_frame, VIDEO_BUFFER_SIZE) != 0) {
+      printf("MISMATCH: screen_draw_run differs from reference on pass %zu\n",
+             pass);
+      return 1;
+    }
+  }
+
+  double reference = 0;
+  double current = 0;
+  double runs = 0;
+
+  for (int round = 0; round < ROUNDS; round++) {
+    double rate = measure(reference_draw_screen);
+    if (rate > reference)
+      reference = rate;
+
+    rate = measure(draw_screen);
+    if (rate > current)
+      current = rate;
+
+    rate = measure(draw_screen_runs);
+    if (rate > runs)
+      runs = rate;
+  }
+
+  printf("%-22s %12.0f glyphs/s %8.1f ns/glyph\n", "reference setSixBitsAt",
+         reference, 1e9 / reference);
+  printf("%-22s %12.0f glyphs/s %8.1f ns/glyph %6.2fx\n",
+         "screen_draw_codepoint", current, 1e9 / current, current / reference);
+  printf("%-22s %12.0f glyphs/s %8.1f ns/glyph %6.2fx\n", "screen_draw_run",
+         runs, 1e9 / runs, runs / reference);
+
+  return 0;
+}
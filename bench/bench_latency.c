@@ -0,0 +1,163 @@
+#include "bench.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "corpus.h"
+#include "host/host.h"
+
+// Measures the worst case time the main loop spends away from the receive
+// buffer. Each corpus is fed in receive chunks with deferred rendering, the
+// move engine and the video ring, as on the device, and every chunk is
+// followed by a flush: either the whole of it, or one slice of
+// terminal_screen_flush_slice. The longest chunk, the most time per byte of a
+// chunk and the longest flush are reported, each the smallest of a few runs
+// so that a preempted run does not count, against the time a byte takes on
+// the wire and the time the receive buffer takes to fill. The frames both
+// modes leave behind are checked to be identical.
+
+#define RUNS 3
+
+// Matches SERIAL_RX_CHUNK_SIZE in main.c.
+#define CHUNK_SIZE 64
+
+// Matches FLUSH_SLICE_CELLS in main.c.
+#define FLUSH_SLICE_CELLS 240
+
+// Matches SERIAL_RX_BUF_SIZE in main.c.
+#define RX_BUF_SIZE 8192
+
+// 8N1 framing: ten bits on the wire per byte.
+#define LINE_RATE(baud) ((baud) / 10)
+
+struct latency {
+  uint64_t chunk_ns;
+  double byte_ns;
+  uint64_t flush_ns;
+};
+
+static void flush(struct terminal *terminal, bool sliced) {
+  if (sliced)
+    terminal_screen_flush_slice(terminal, FLUSH_SLICE_CELLS);
+  else
+    terminal_screen_flush(terminal);
+}
+
+static struct latency run(struct terminal_config *config,
+                          const struct corpus *corpus, bool sliced) {
+  struct terminal *terminal = host_init(config);
+  terminal_screen_set_deferred_render(terminal, true);
+  host_use_move_backend(true);
+  host_use_ring_backend(true);
+  host_use_render_thread(false);
+
+  struct latency latency = {0};
+
+  for (size_t i = 0; i < corpus->size; i += CHUNK_SIZE) {
+    size_t size = corpus->size - i;
+    if (size > CHUNK_SIZE)
+      size = CHUNK_SIZE;
+
+    uint64_t start = bench_now_ns();
+    terminal_uart_receive_buffer(terminal, corpus->data + i, size);
+    uint64_t received = bench_now_ns();
+    flush(terminal, sliced);
+    uint64_t flushed = bench_now_ns();
+
+    if (received - start > latency.chunk_ns)
+      latency.chunk_ns = received - start;
+    if ((double)(received - start) / size > latency.byte_ns)
+      latency.byte_ns = (double)(received - start) / size;
+    if (flushed - received > latency.flush_ns)
+      latency.flush_ns = flushed - received;
+  }
+
+  while (terminal_screen_flush_slice(terminal, FLUSH_SLICE_CELLS))
+    ;
+  host_wait_move();
+
+  return latency;
+}
+
+static struct latency measure(struct terminal_config *config,
+                              const struct corpus *corpus, bool sliced) {
+  struct latency best = run(config, corpus, sliced);
+
+  for (int i = 1; i < RUNS; i++) {
+    struct latency latency = run(config, corpus, sliced);
+
+    if (latency.chunk_ns < best.chunk_ns)
+      best.chunk_ns = latency.chunk_ns;
+    if (latency.byte_ns < best.byte_ns)
+      best.byte_ns = latency.byte_ns;
+    if (latency.flush_ns < best.flush_ns)
+      best.flush_ns = latency.flush_ns;
+  }
+
+  return best;
+}
+
+static void print_latency(const struct corpus *corpus, const char *mode,
+                          struct latency latency) {
+  // The receive buffer absorbs whatever arrives while the loop is away, so a
+  // step only loses data once it outlasts the time the buffer takes to fill.
+  double step_us = (latency.chunk_ns + latency.flush_ns) / 1e3;
+
+  printf("%-10s %-6s %10.1f %10.1f %10.1f %10.1f %9.2f%% %9.2f%%\n",
+         corpus->name, mode, latency.chunk_ns / 1e3, latency.byte_ns,
+         latency.flush_ns / 1e3, step_us,
+         step_us * 100 / (RX_BUF_SIZE * 1e6 / LINE_RATE(115200)),
+         step_us * 100 / (RX_BUF_SIZE * 1e6 / LINE_RATE(921600)));
+}
+
+static bool run_corpus(struct terminal_config *config,
+                       const struct corpus *corpus) {
+  struct latency full = measure(config, corpus, false);
+  uint32_t expected = host_digest();
+  struct latency sliced = measure(config, corpus, true);
+  uint32_t digest = host_digest();
+
+  print_latency(corpus, "full", full);
+  print_latency(corpus, "sliced", sliced);
+
+  if (digest != expected) {
+    printf("%-10s MISMATCH: full flush frame %08x, sliced flush frame %08x\n",
+           corpus->name, expected, digest);
+    return false;
+  }
+
+  return true;
+}
+
+int bench_latency(int argc, char **argv) {
+  struct terminal_config config;
+  host_default_config(&config);
+
+  bool ok = true;
+
+  for (int i = 0; i < argc; i++)
+    if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+      config.format_rows =
+          strcmp(argv[++i], "30") == 0 ? FORMAT_30_ROWS : FORMAT_24_ROWS;
+
+  printf("byte time: %.1f us at 115200, %.1f us at 921600 (8N1); %d byte "
+         "receive buffer fills in %.1f ms, %.1f ms\n",
+         1e6 / LINE_RATE(115200), 1e6 / LINE_RATE(921600), RX_BUF_SIZE,
+         RX_BUF_SIZE * 1e3 / LINE_RATE(115200),
+         RX_BUF_SIZE * 1e3 / LINE_RATE(921600));
+  printf("%-10s %-6s %10s %10s %10s %10s %10s %10s\n", "corpus", "flush",
+         "chunk us", "ns/byte", "flush us", "step us", "of 115200",
+         "of 921600");
+
+  for (const struct corpus_generator *generator = corpus_generators;
+       generator->name; generator++) {
+    struct corpus corpus;
+    corpus_generate(&corpus, generator);
+
+    ok &= run_corpus(&config, &corpus);
+    corpus_free(&corpus);
+  }
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,190 @@
+#include "bench.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "ring/ring.h"
+
+// Streams a known byte sequence through the SPSC ring from a producer thread
+// to the consumer on the main thread, alternating between the single byte,
+// bulk and zero-copy span calls on both sides, and checks every byte arrives
+// once and in order with nothing dropped. Also checks that writes to a full
+// ring are dropped and counted without disturbing what is queued, and reports
+// throughput by ring size.
+
+#define STREAM_SIZE (16 * 1024 * 1024)
+
+#define MAX_RING_SIZE 8192
+
+static uint8_t sequence_byte(size_t i) {
+  return (uint8_t)(i ^ (i >> 8) ^ (i >> 16) ^ (i >> 24));
+}
+
+static size_t next_size(uint32_t *state, size_t limit) {
+  *state = *state * 1103515245 + 12345;
+
+  return 1 + (*state >> 8) % limit;
+}
+
+static void *produce(void *arg) {
+  struct ring *ring = arg;
+  uint32_t state = 1;
+  size_t produced = 0;
+
+  while (produced < STREAM_SIZE) {
+    size_t size = next_size(&state, 3 * ring->size / 2);
+    if (size > STREAM_SIZE - produced)
+      size = STREAM_SIZE - produced;
+
+    size_t space = ring_space(ring);
+    if (!space) {
+      sched_yield();
+      continue;
+    }
+
+    if (size > space)
+      size = space;
+
+    switch (produced % 3) {
+    case 0:
+      for (size_t i = 0; i < size; i++)
+        ring_push(ring, sequence_byte(produced + i));
+      break;
+    case 1: {
+      uint8_t data[MAX_RING_SIZE];
+
+      for (size_t i = 0; i < size; i++)
+        data[i] = sequence_byte(produced + i);
+
+      ring_write(ring, data, size);
+      break;
+    }
+    case 2: {
+      uint8_t *data;
+      size_t contiguous = ring_reserve_contiguous(ring, &data);
+      if (size > contiguous)
+        size = contiguous;
+
+      for (size_t i = 0; i < size; i++)
+        data[i] = sequence_byte(produced + i);
+
+      ring_publish(ring, size);
+      break;
+    }
+    }
+
+    produced += size;
+  }
+
+  return NULL;
+}
+
+static bool consume(struct ring *ring, size_t *mismatch) {
+  uint32_t state = 2;
+  size_t consumed = 0;
+
+  while (consumed < STREAM_SIZE) {
+    if (!ring_available(ring)) {
+      sched_yield();
+      continue;
+    }
+
+    if (next_size(&state, 2) == 1) {
+      uint8_t byte;
+
+      ring_pop(ring, &byte);
+      if (byte != sequence_byte(consumed)) {
+        *mismatch = consumed;
+        return false;
+      }
+
+      consumed++;
+    } else {
+      const uint8_t *data;
+      size_t size = ring_peek_contiguous(ring, &data);
+
+      for (size_t i = 0; i < size; i++)
+        if (data[i] != sequence_byte(consumed + i)) {
+          *mismatch = consumed + i;
+          return false;
+        }
+
+      ring_commit(ring, size);
+      consumed += size;
+    }
+  }
+
+  return true;
+}
+
+static bool check_overflow() {
+  uint8_t buffer[64];
+  uint8_t data[100];
+  struct ring ring;
+
+  for (size_t i = 0; i < sizeof(data); i++)
+    data[i] = sequence_byte(i);
+
+  ring_init(&ring, buffer, sizeof(buffer));
+
+  bool ok = ring_write(&ring, data, 40) == 40 &&
+            ring_write(&ring, data + 40, 40) == 24 &&
+            !ring_push(&ring, 0) && ring_dropped(&ring) == 17 &&
+            ring_available(&ring) == 64;
+
+  for (size_t i = 0; ok && i < 64; i++) {
+    uint8_t byte;
+    ok = ring_pop(&ring, &byte) && byte == sequence_byte(i);
+  }
+
+  return ok && !ring_available(&ring);
+}
+
+int bench_ring(int argc, char **argv) {
+  static const size_t sizes[] = {64, 256, 8192};
+  static uint8_t buffer[MAX_RING_SIZE];
+  bool ok = true;
+
+  if (!check_overflow()) {
+    printf("MISMATCH: writes to a full ring were not dropped and counted\n");
+    ok = false;
+  }
+
+  printf("%-8s %14s %10s\n", "size", "bytes/s", "dropped");
+
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    struct ring ring;
+    ring_init(&ring, buffer, sizes[s]);
+
+    pthread_t producer;
+    uint64_t start = bench_now_ns();
+    pthread_create(&producer, NULL, produce, &ring);
+
+    size_t mismatch = 0;
+    bool consumed = consume(&ring, &mismatch);
+
+    if (consumed) {
+      pthread_join(producer, NULL);
+    } else {
+      // The producer may be stuck on a full ring; it is left behind.
+      pthread_detach(producer);
+      printf("%-8zu MISMATCH: byte %zu arrived wrong\n", sizes[s], mismatch);
+      return 1;
+    }
+
+    uint64_t elapsed = bench_now_ns() - start;
+
+    if (ring_dropped(&ring)) {
+      printf("%-8zu MISMATCH: %zu bytes dropped\n", sizes[s],
+             ring_dropped(&ring));
+      ok = false;
+    }
+
+    printf("%-8zu %14.0f %10zu\n", sizes[s], STREAM_SIZE * 1e9 / elapsed,
+           ring_dropped(&ring));
+  }
+
+  return ok ? 0 : 1;
+}
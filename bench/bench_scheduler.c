@@ -0,0 +1,278 @@
+#include "bench.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "corpus.h"
+#include "host/host.h"
+#include "scheduler/scheduler.h"
+
+// Checks the scheduler's ordering, periods, budgets and yield gating against
+// a clock that only moves when told to, then runs each corpus through the
+// tasks main.c uses with keystrokes arriving at a steady rate, and reports how
+// long they waited. A keystroke should wait no longer than the yield interval
+// plus the longest stretch between yields, which is reported as well. The
+// frames are checked against feeding the corpus in one go.
+
+// Match main.c.
+#define CHUNK_SIZE 64
+#define FLUSH_SLICE_CELLS 240
+#define YIELD_INTERVAL_US 1000
+#define KEYBOARD_BUDGET_US 200
+#define PARSE_BUDGET_US 2000
+#define FLUSH_BUDGET_US 2000
+
+#define KEY_INTERVAL_US 2500
+
+static uint64_t fake_now;
+
+static uint64_t fake_now_us() { return fake_now; }
+
+static char trace[64];
+static size_t trace_size;
+static uint64_t a_start;
+static uint64_t a_deadline;
+static bool b_yields;
+static struct scheduler check_scheduler;
+
+static void clear_trace() {
+  trace_size = 0;
+  trace[0] = '\0';
+}
+
+static void record(char task) {
+  if (trace_size < sizeof(trace) - 1)
+    trace[trace_size++] = task;
+  trace[trace_size] = '\0';
+}
+
+static bool task_a(uint64_t deadline_us) {
+  record('a');
+  a_start = fake_now;
+  a_deadline = deadline_us;
+  fake_now += 10;
+  return false;
+}
+
+static bool task_b(uint64_t deadline_us) {
+  record('b');
+  fake_now += 10;
+
+  // Long enough for a yield to get through, which must not run b again.
+  if (b_yields) {
+    fake_now += YIELD_INTERVAL_US;
+    scheduler_yield(&check_scheduler);
+  }
+
+  return false;
+}
+
+static int c_more = 0;
+
+static bool task_c(uint64_t deadline_us) {
+  record('c');
+  fake_now += 10;
+  return c_more-- > 0;
+}
+
+static bool check(const char *name, const char *expected) {
+  if (strcmp(trace, expected) == 0)
+    return true;
+
+  printf("%-32s MISMATCH: ran \"%s\", expected \"%s\"\n", name, trace,
+         expected);
+  return false;
+}
+
+static bool run_checks() {
+  struct scheduler_task tasks[] = {
+      {.name = "a", .run = task_a, .budget_us = 100, .preempts = true},
+      {.name = "b", .run = task_b, .preempts = true},
+      {.name = "c", .run = task_c, .period_us = 5000},
+  };
+  bool ok = true;
+
+  fake_now = 0;
+  scheduler_init(&check_scheduler, tasks, 3, fake_now_us, YIELD_INTERVAL_US);
+
+  // b yields once its interval is up, which runs a again but not b.
+  clear_trace();
+  b_yields = true;
+  scheduler_run(&check_scheduler);
+  b_yields = false;
+  ok &= check("priority order and yield", "abac");
+
+  if (a_deadline != a_start + 100) {
+    printf("%-32s MISMATCH: deadline %llu, expected %llu\n", "budget",
+           (unsigned long long)a_deadline,
+           (unsigned long long)a_start + 100);
+    ok = false;
+  }
+
+  // c is not due again until its period is up.
+  clear_trace();
+  scheduler_run(&check_scheduler);
+  ok &= check("period", "ab");
+
+  fake_now += 5000;
+  c_more = 1;
+  clear_trace();
+  scheduler_run(&check_scheduler);
+  scheduler_run(&check_scheduler);
+  ok &= check("work left over keeps a task due", "abcabc");
+
+  // Too soon after the last pass.
+  clear_trace();
+  fake_now += YIELD_INTERVAL_US / 2;
+  scheduler_yield(&check_scheduler);
+  ok &= check("yield within interval", "");
+
+  fake_now += YIELD_INTERVAL_US;
+  scheduler_yield(&check_scheduler);
+  ok &= check("yield after interval", "ab");
+
+  return ok;
+}
+
+static const struct corpus *load_corpus;
+static size_t load_offset;
+static struct terminal *load_terminal;
+static struct scheduler load_scheduler;
+
+static uint64_t next_key_us;
+static size_t keys;
+static uint64_t total_wait_us;
+static uint64_t max_wait_us;
+static uint64_t last_yield_us;
+static uint64_t max_yield_gap_us;
+
+static uint64_t now_us() { return bench_now_ns() / 1000; }
+
+static void load_yield() {
+  uint64_t now = now_us();
+
+  if (now - last_yield_us > max_yield_gap_us)
+    max_yield_gap_us = now - last_yield_us;
+  last_yield_us = now;
+
+  scheduler_yield(&load_scheduler);
+}
+
+static bool keyboard_task(uint64_t deadline_us) {
+  uint64_t now = now_us();
+
+  for (; next_key_us <= now; next_key_us += KEY_INTERVAL_US) {
+    keys++;
+    total_wait_us += now - next_key_us;
+    if (now - next_key_us > max_wait_us)
+      max_wait_us = now - next_key_us;
+  }
+
+  return false;
+}
+
+static bool parse_task(uint64_t deadline_us) {
+  while (load_offset < load_corpus->size && now_us() < deadline_us) {
+    size_t size = load_corpus->size - load_offset;
+    if (size > CHUNK_SIZE)
+      size = CHUNK_SIZE;
+
+    terminal_uart_receive_buffer(load_terminal,
+                                 load_corpus->data + load_offset, size);
+    load_offset += size;
+    load_yield();
+  }
+
+  return load_offset < load_corpus->size;
+}
+
+static bool flush_task(uint64_t deadline_us) {
+  while (terminal_screen_flush_slice(load_terminal, FLUSH_SLICE_CELLS))
+    if (now_us() >= deadline_us)
+      return true;
+
+  return false;
+}
+
+static struct terminal *init_terminal(struct terminal_config *config) {
+  struct terminal *terminal = host_init(config);
+
+  terminal_screen_set_deferred_render(terminal, true);
+  host_use_move_backend(true);
+  host_use_ring_backend(true);
+  host_use_render_thread(false);
+
+  return terminal;
+}
+
+static bool run_load(struct terminal_config *config,
+                     const struct corpus *corpus) {
+  struct terminal *terminal = init_terminal(config);
+  terminal_uart_receive_buffer(terminal, corpus->data, corpus->size);
+  terminal_screen_flush(terminal);
+  uint32_t expected = host_digest();
+
+  struct scheduler_task tasks[] = {
+      {.name = "keyboard", .run = keyboard_task,
+       .budget_us = KEYBOARD_BUDGET_US, .preempts = true},
+      {.name = "parse", .run = parse_task, .budget_us = PARSE_BUDGET_US},
+      {.name = "flush", .run = flush_task, .budget_us = FLUSH_BUDGET_US},
+  };
+
+  load_corpus = corpus;
+  load_offset = 0;
+  load_terminal = init_terminal(config);
+  host_set_yield_hook(load_yield);
+  scheduler_init(&load_scheduler, tasks, 3, now_us, YIELD_INTERVAL_US);
+
+  keys = total_wait_us = max_wait_us = max_yield_gap_us = 0;
+  next_key_us = last_yield_us = now_us();
+  uint64_t start = next_key_us;
+
+  while (scheduler_run(&load_scheduler))
+    ;
+
+  uint64_t elapsed = now_us() - start;
+  host_set_yield_hook(NULL);
+  uint32_t digest = host_digest();
+
+  printf("%-10s %8.1f %6zu %10.1f %10llu %10llu %10llu\n", corpus->name,
+         elapsed / 1e3, keys, keys ? (double)total_wait_us / keys : 0.0,
+         (unsigned long long)max_wait_us,
+         (unsigned long long)max_yield_gap_us,
+         (unsigned long long)(YIELD_INTERVAL_US + max_yield_gap_us));
+
+  if (digest != expected) {
+    printf("%-10s MISMATCH: frame %08x, scheduled frame %08x\n",
+           corpus->name, expected, digest);
+    return false;
+  }
+
+  return true;
+}
+
+int bench_scheduler(int argc, char **argv) {
+  struct terminal_config config;
+  host_default_config(&config);
+
+  for (int i = 0; i < argc; i++)
+    if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+      config.format_rows =
+          strcmp(argv[++i], "30") == 0 ? FORMAT_30_ROWS : FORMAT_24_ROWS;
+
+  bool ok = run_checks();
+
+  printf("%-10s %8s %6s %10s %10s %10s %10s\n", "corpus", "ms", "keys",
+         "mean us", "max us", "gap us", "bound us");
+
+  for (const struct corpus_generator *generator = corpus_generators;
+       generator->name; generator++) {
+    struct corpus corpus;
+    corpus_generate(&corpus, generator);
+
+    ok &= run_load(&config, &corpus);
+    corpus_free(&corpus);
+  }
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,97 @@
+#include "bench.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "host/host.h"
+#include "null_callbacks.h"
+
+// Measures the cost of a line feed at the bottom margin for scrolling regions
+// of growing height. The cells column runs the terminal against screen
+// callbacks that do nothing, so it only counts the visual cell bookkeeping,
+// which should not grow with the region height; the screen column adds the
+// host framebuffer with deferred rendering and a flush after each batch of
+// line feeds, as the main loop would, so jump scrolling hands the whole batch
+// to the framebuffer as one scroll. The smooth column is the same with DECSCLM
+// set, scrolling the framebuffer once per line feed. Blinking is held off, as
+// every scroll otherwise scans the whole screen for blinking cells twice and
+// that drowns out the rest.
+
+#define MIN_DURATION_NS 100000000ULL
+
+#define LINE_FEEDS 256
+
+static struct visual_cell cells[TERMINAL_MAX_ROWS * TERMINAL_MAX_COLS];
+static uint8_t tab_stops[TERMINAL_MAX_COLS / 8];
+
+static void set_region(struct terminal *terminal, size_t height,
+                       bool smooth) {
+  char sequence[32];
+
+  terminal->blink_on = false;
+
+  snprintf(sequence, sizeof(sequence), "\x1b[?4%c\x1b[1;%zur\x1b[%zu;1H",
+           smooth ? 'h' : 'l', height, height);
+  terminal_uart_receive_string(terminal, sequence);
+}
+
+static double measure(struct terminal *terminal) {
+  character_t line_feeds[LINE_FEEDS];
+  memset(line_feeds, '\n', LINE_FEEDS);
+
+  size_t count = 0;
+  uint64_t start = bench_now_ns();
+  uint64_t elapsed = 0;
+
+  do {
+    terminal_uart_receive_buffer(terminal, line_feeds, LINE_FEEDS);
+    terminal_screen_flush(terminal);
+
+    count += LINE_FEEDS;
+    elapsed = bench_now_ns() - start;
+  } while (elapsed < MIN_DURATION_NS);
+
+  return (double)elapsed / count;
+}
+
+int bench_scroll(int argc, char **argv) {
+  struct terminal_config config;
+  host_default_config(&config);
+
+  for (int i = 0; i < argc; i++)
+    if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+      config.format_rows =
+          strcmp(argv[++i], "30") == 0 ? FORMAT_30_ROWS : FORMAT_24_ROWS;
+
+  size_t rows = config.format_rows == FORMAT_30_ROWS ? 30 : 24;
+
+  struct terminal terminal;
+  terminal_init(&terminal, &null_callbacks, cells,
+#ifdef TERMINAL_ALT_CELLS
+                NULL,
+#endif
+                tab_stops, sizeof(tab_stops), &config);
+
+  printf("%-8s %14s %14s %14s\n", "region", "cells ns/LF", "screen ns/LF",
+         "smooth ns/LF");
+
+  for (size_t height = 2; height <= rows; height += height < 6 ? 2 : 6) {
+    set_region(&terminal, height, false);
+    double cells_ns = measure(&terminal);
+
+    struct terminal *host_terminal = host_init(&config);
+    terminal_screen_set_deferred_render(host_terminal, true);
+    set_region(host_terminal, height, false);
+    double screen_ns = measure(host_terminal);
+
+    host_terminal = host_init(&config);
+    terminal_screen_set_deferred_render(host_terminal, true);
+    set_region(host_terminal, height, true);
+    double smooth_ns = measure(host_terminal);
+
+    printf("1-%-6zu %14.1f %14.1f %14.1f\n", height, cells_ns, screen_ns,
+           smooth_ns);
+  }
+
+  return 0;
+}
@@ -0,0 +1,311 @@
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "corpus.h"
+#include "host/host.h"
+
+// Feeds recorded or generated host output through the receive path with the
+// real screen callbacks and reports throughput against the serial line rate,
+// plus a breakdown of where the time goes by receive state. The per-byte
+// terminal_uart_receive_character path, the chunked
+// terminal_uart_receive_buffer path, the same with deferred rendering, and
+// with scrolls handed to the mock background move engine as well, and with
+// full-screen scrolls turned into rotations of the video ring on top are
+// measured, as is all of that with rasterising moved to a second thread
+// behind the screen command queue, the way core 1 runs it on the device. The
+// frames they leave behind are checked to be identical.
+
+#define MIN_DURATION_NS 250000000ULL
+#define MAX_BREAKDOWN_ENTRIES 64
+
+// Matches SERIAL_RX_CHUNK_SIZE in main.c.
+#define CHUNK_SIZE 64
+
+// How much input is absorbed between flushes in deferred render mode; the main
+// loop flushes whenever the receive buffer runs dry.
+#define FLUSH_INTERVAL 2048
+
+// 8N1 framing: ten bits on the wire per byte.
+#define LINE_RATE(baud) ((baud) / 10)
+
+struct breakdown_entry {
+  const char *state;
+  const char *class;
+  size_t bytes;
+  uint64_t ns;
+  uint64_t max_ns;
+};
+
+static const char *character_class(character_t character) {
+  if (character < 0x20 || character == 0x7f)
+    return "C0";
+  if (character < 0x80)
+    return "GL";
+  if (character < 0xa0)
+    return "C1";
+  return "GR";
+}
+
+static struct breakdown_entry *
+find_entry(struct breakdown_entry *entries, size_t *count, const char *state,
+           const char *class) {
+  for (size_t i = 0; i < *count; i++)
+    if (entries[i].state == state && entries[i].class == class)
+      return &entries[i];
+
+  if (*count == MAX_BREAKDOWN_ENTRIES)
+    return NULL;
+
+  struct breakdown_entry *entry = &entries[(*count)++];
+  *entry = (struct breakdown_entry){.state = state, .class = class};
+
+  return entry;
+}
+
+static int compare_entries(const void *a, const void *b) {
+  const struct breakdown_entry *entry_a = a;
+  const struct breakdown_entry *entry_b = b;
+
+  return entry_a->ns < entry_b->ns ? 1 : entry_a->ns > entry_b->ns ? -1 : 0;
+}
+
+static uint64_t timer_overhead_ns() {
+  uint64_t start = bench_now_ns();
+  for (size_t i = 0; i < 1000; i++)
+    bench_now_ns();
+
+  return (bench_now_ns() - start) / 1000;
+}
+
+enum receive_path {
+  RECEIVE_PATH_CHARACTER,
+  RECEIVE_PATH_BUFFER,
+  RECEIVE_PATH_DEFERRED,
+  RECEIVE_PATH_MOVE,
+  RECEIVE_PATH_RING,
+  RECEIVE_PATH_THREAD,
+  RECEIVE_PATH_COUNT,
+};
+
+static const char *receive_path_names[] = {
+    [RECEIVE_PATH_CHARACTER] = "character",
+    [RECEIVE_PATH_BUFFER] = "buffer",
+    [RECEIVE_PATH_DEFERRED] = "deferred",
+    [RECEIVE_PATH_MOVE] = "move",
+    [RECEIVE_PATH_RING] = "ring",
+    [RECEIVE_PATH_THREAD] = "thread",
+};
+
+static struct terminal *init_path(struct terminal_config *config,
+                                  enum receive_path path) {
+  struct terminal *terminal = host_init(config);
+
+  terminal_screen_set_deferred_render(terminal,
+                                      path >= RECEIVE_PATH_DEFERRED);
+  host_use_move_backend(path >= RECEIVE_PATH_MOVE);
+  host_use_ring_backend(path >= RECEIVE_PATH_RING);
+  host_use_render_thread(path == RECEIVE_PATH_THREAD);
+
+  return terminal;
+}
+
+static void receive(struct terminal *terminal, enum receive_path path,
+                    const struct corpus *corpus) {
+  switch (path) {
+  case RECEIVE_PATH_CHARACTER:
+    for (size_t i = 0; i < corpus->size; i++)
+      terminal_uart_receive_character(terminal, corpus->data[i]);
+    break;
+  case RECEIVE_PATH_BUFFER:
+    for (size_t i = 0; i < corpus->size; i += CHUNK_SIZE) {
+      size_t size = corpus->size - i;
+      terminal_uart_receive_buffer(terminal, corpus->data + i,
+                                   size < CHUNK_SIZE ? size : CHUNK_SIZE);
+    }
+    break;
+  case RECEIVE_PATH_DEFERRED:
+  case RECEIVE_PATH_MOVE:
+  case RECEIVE_PATH_RING:
+  case RECEIVE_PATH_THREAD:
+    for (size_t i = 0; i < corpus->size; i += CHUNK_SIZE) {
+      size_t size = corpus->size - i;
+      terminal_uart_receive_buffer(terminal, corpus->data + i,
+                                   size < CHUNK_SIZE ? size : CHUNK_SIZE);
+
+      if ((i + CHUNK_SIZE) % FLUSH_INTERVAL == 0)
+        terminal_screen_flush(terminal);
+    }
+
+    terminal_screen_flush(terminal);
+    host_wait_move();
+    break;
+  default:
+    break;
+  }
+}
+
+static void run_throughput(struct terminal_config *config,
+                           const struct corpus *corpus,
+                           enum receive_path path) {
+  struct terminal *terminal = init_path(config, path);
+
+  size_t bytes = 0;
+  uint64_t start = bench_now_ns();
+  uint64_t elapsed = 0;
+
+  do {
+    receive(terminal, path, corpus);
+
+    bytes += corpus->size;
+    elapsed = bench_now_ns() - start;
+  } while (elapsed < MIN_DURATION_NS);
+
+  double bytes_per_second = bytes * 1e9 / elapsed;
+
+  printf("%-10s %-9s %8zu bytes %12.0f bytes/s %8.1f ns/byte %7.1fx 115200 "
+         "%6.1fx 921600\n",
+         corpus->name, receive_path_names[path], corpus->size,
+         bytes_per_second, (double)elapsed / bytes,
+         bytes_per_second / LINE_RATE(115200),
+         bytes_per_second / LINE_RATE(921600));
+}
+
+static bool check_paths(struct terminal_config *config,
+                        const struct corpus *corpus) {
+  receive(init_path(config, RECEIVE_PATH_CHARACTER), RECEIVE_PATH_CHARACTER,
+          corpus);
+  uint32_t expected = host_digest();
+  bool ok = true;
+
+  for (enum receive_path path = RECEIVE_PATH_BUFFER; path < RECEIVE_PATH_COUNT;
+       path++) {
+    receive(init_path(config, path), path, corpus);
+    uint32_t digest = host_digest();
+
+    if (digest != expected) {
+      printf("%-10s MISMATCH: character path frame %08x, %s path frame "
+             "%08x\n",
+             corpus->name, expected, receive_path_names[path], digest);
+      ok = false;
+    }
+  }
+
+  return ok;
+}
+
+static void run_breakdown(struct terminal_config *config,
+                          const struct corpus *corpus, uint64_t overhead) {
+  struct terminal *terminal = host_init(config);
+
+  struct breakdown_entry entries[MAX_BREAKDOWN_ENTRIES];
+  size_t count = 0;
+  uint64_t total = 0;
+
+  for (size_t i = 0; i < corpus->size; i++) {
+    character_t character = corpus->data[i];
+    struct breakdown_entry *entry =
+        find_entry(entries, &count, terminal_uart_receive_state(terminal),
+                   character_class(character));
+
+    uint64_t start = bench_now_ns();
+    terminal_uart_receive_character(terminal, character);
+    uint64_t ns = bench_now_ns() - start;
+
+    ns = ns > overhead ? ns - overhead : 0;
+    total += ns;
+
+    if (entry) {
+      entry->bytes++;
+      entry->ns += ns;
+      if (ns > entry->max_ns)
+        entry->max_ns = ns;
+    }
+  }
+
+  qsort(entries, count, sizeof(struct breakdown_entry), compare_entries);
+
+  printf("  %-20s %-5s %8s %7s %9s %9s\n", "state", "class", "bytes",
+         "time", "ns/byte", "max ns");
+  for (size_t i = 0; i < count; i++)
+    printf("  %-20s %-5s %8zu %6.1f%% %9.1f %9llu\n", entries[i].state,
+           entries[i].class, entries[i].bytes,
+           total ? entries[i].ns * 100.0 / total : 0.0,
+           (double)entries[i].ns / entries[i].bytes,
+           (unsigned long long)entries[i].max_ns);
+}
+
+static bool run_corpus(struct terminal_config *config,
+                       const struct corpus *corpus, bool breakdown,
+                       uint64_t overhead) {
+  bool ok = check_paths(config, corpus);
+
+  for (enum receive_path path = 0; path < RECEIVE_PATH_COUNT; path++)
+    run_throughput(config, corpus, path);
+
+  if (breakdown)
+    run_breakdown(config, corpus, overhead);
+
+  return ok;
+}
+
+int bench_stream(int argc, char **argv) {
+  struct terminal_config config;
+  host_default_config(&config);
+
+  bool breakdown = true;
+  bool ok = true;
+  int files = 0;
+
+  for (int i = 0; i < argc; i++) {
+    if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+      config.format_rows =
+          strcmp(argv[++i], "30") == 0 ? FORMAT_30_ROWS : FORMAT_24_ROWS;
+    else if (strcmp(argv[i], "-q") == 0)
+      breakdown = false;
+    else
+      files++;
+  }
+
+  uint64_t overhead = timer_overhead_ns();
+
+  printf("line rate: %d bytes/s at 115200, %d bytes/s at 921600 (8N1)\n",
+         LINE_RATE(115200), LINE_RATE(921600));
+  if (breakdown)
+    printf("breakdown timer overhead: %llu ns/byte (subtracted)\n",
+           (unsigned long long)overhead);
+
+  if (files) {
+    for (int i = 0; i < argc; i++) {
+      if (strcmp(argv[i], "-r") == 0) {
+        i++;
+        continue;
+      }
+
+      if (argv[i][0] == '-')
+        continue;
+
+      struct corpus corpus;
+      if (!corpus_load(&corpus, argv[i])) {
+        perror(argv[i]);
+        return 1;
+      }
+
+      ok &= run_corpus(&config, &corpus, breakdown, overhead);
+      corpus_free(&corpus);
+    }
+  } else {
+    for (const struct corpus_generator *generator = corpus_generators;
+         generator->name; generator++) {
+      struct corpus corpus;
+      corpus_generate(&corpus, generator);
+
+      ok &= run_corpus(&config, &corpus, breakdown, overhead);
+      corpus_free(&corpus);
+    }
+  }
+
+  return ok ? 0 : 1;
+}
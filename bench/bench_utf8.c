@@ -0,0 +1,165 @@
+#include "bench.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "corpus.h"
+#include "host/host.h"
+#include "null_callbacks.h"
+
+// Checks what the UTF-8 decoder draws for well-formed and malformed input,
+// fed a byte at a time, as one buffer and split in two at every point, and
+// reports decoding throughput of the generated Cyrillic and box drawing
+// corpus and of plain ASCII against screen callbacks that do nothing, so the
+// numbers are not drowned out by rasterising.
+
+#define MIN_DURATION_NS 250000000ULL
+
+#define REPLACEMENT 0xfffd
+
+#define MAX_EXPECTED 16
+
+struct utf8_case {
+  const char *name;
+  const char *input;
+  codepoint_t expected[MAX_EXPECTED];
+};
+
+static const struct utf8_case cases[] = {
+    {"ascii", "abc", {'a', 'b', 'c'}},
+    {"cyrillic", "\xd0\x9f\xd1\x80\xd0\xb8", {0x41f, 0x440, 0x438}},
+    {"box drawing", "\xe2\x94\x9c\xe2\x94\x80x", {0x251c, 0x2500, 'x'}},
+    {"stray continuation", "a\x80\xbf" "b", {'a', REPLACEMENT, REPLACEMENT, 'b'}},
+    {"overlong two bytes", "\xc0\xaf" "b", {REPLACEMENT, REPLACEMENT, 'b'}},
+    {"overlong three bytes",
+     "\xe0\x80\xaf",
+     {REPLACEMENT, REPLACEMENT, REPLACEMENT}},
+    {"surrogate", "\xed\xa0\x80", {REPLACEMENT, REPLACEMENT, REPLACEMENT}},
+    {"truncated", "\xe2\x94x\xd0y", {REPLACEMENT, 'x', REPLACEMENT, 'y'}},
+    {"past the BMP", "\xf0\x9f\x98\x80" "b", {REPLACEMENT, 'b'}},
+    {"past U+10FFFF",
+     "\xf4\xa0\x80\x80",
+     {REPLACEMENT, REPLACEMENT, REPLACEMENT, REPLACEMENT}},
+    {"invalid lead", "\xf5\xff" "b", {REPLACEMENT, REPLACEMENT, 'b'}},
+    {"interrupted by ESC",
+     "\xd0\x1b[1m\xd0\x9f",
+     {REPLACEMENT, 0x41f}},
+    {"interrupted by CR", "x\xe2\x94\rb", {'b'}},
+    {NULL},
+};
+
+static struct visual_cell cells[TERMINAL_MAX_ROWS * TERMINAL_MAX_COLS];
+static uint8_t tab_stops[TERMINAL_MAX_COLS / 8];
+
+static codepoint_t drawn[TERMINAL_MAX_COLS];
+
+static void record_codepoint(struct format format, size_t row, size_t col,
+                             codepoint_t codepoint, enum font font,
+                             bool italic, bool underlined, bool crossedout,
+                             color_t active, color_t inactive) {
+  if (row == 0)
+    drawn[col] = codepoint;
+}
+
+// The null callbacks, but recording what is drawn on the top row.
+static struct terminal_callbacks record_callbacks;
+
+static void init(struct terminal *terminal,
+                 const struct terminal_callbacks *callbacks) {
+  struct terminal_config config;
+  host_default_config(&config);
+  config.charset = CHARSET_UTF8;
+
+  terminal_init(terminal, callbacks, cells,
+#ifdef TERMINAL_ALT_CELLS
+                NULL,
+#endif
+                tab_stops, sizeof(tab_stops), &config);
+}
+
+// Splits the input in two at split, or feeds it a byte at a time when split
+// is past the end.
+static bool check_case(const struct utf8_case *c, size_t split) {
+  const character_t *input = (const character_t *)c->input;
+  size_t size = strlen(c->input);
+
+  struct terminal terminal;
+  init(&terminal, &record_callbacks);
+  memset(drawn, 0, sizeof(drawn));
+
+  if (split > size) {
+    for (size_t i = 0; i < size; i++)
+      terminal_uart_receive_character(&terminal, input[i]);
+  } else {
+    terminal_uart_receive_buffer(&terminal, input, split);
+    terminal_uart_receive_buffer(&terminal, input + split, size - split);
+  }
+
+  size_t count = 0;
+  while (count < MAX_EXPECTED && c->expected[count])
+    count++;
+
+  for (size_t i = 0; i < count; i++)
+    if (drawn[i] != c->expected[i]) {
+      printf("MISMATCH: %s", c->name);
+      if (split <= size)
+        printf(" split at %zu", split);
+      printf(": column %zu drew U+%04x, expected U+%04x\n", i, drawn[i],
+             c->expected[i]);
+      return false;
+    }
+
+  return true;
+}
+
+static double measure(const struct corpus *corpus, bool buffer) {
+  struct terminal terminal;
+  init(&terminal, &null_callbacks);
+
+  size_t bytes = 0;
+  uint64_t start = bench_now_ns();
+  uint64_t elapsed = 0;
+
+  do {
+    if (buffer)
+      terminal_uart_receive_buffer(&terminal, corpus->data, corpus->size);
+    else
+      for (size_t i = 0; i < corpus->size; i++)
+        terminal_uart_receive_character(&terminal, corpus->data[i]);
+
+    bytes += corpus->size;
+    elapsed = bench_now_ns() - start;
+  } while (elapsed < MIN_DURATION_NS);
+
+  return bytes * 1e9 / elapsed;
+}
+
+int bench_utf8(int argc, char **argv) {
+  record_callbacks = null_callbacks;
+  record_callbacks.screen_draw_codepoint = record_codepoint;
+
+  bool ok = true;
+
+  for (const struct utf8_case *c = cases; c->name; c++)
+    for (size_t split = 0; split <= strlen(c->input) + 1; split++)
+      ok &= check_case(c, split);
+
+  printf("%-10s %14s %14s\n", "corpus", "character/s", "buffer/s");
+
+  for (const struct corpus_generator *generator = corpus_generators;
+       generator->name; generator++) {
+    if (strcmp(generator->name, "utf8") != 0 &&
+        strcmp(generator->name, "compiler") != 0)
+      continue;
+
+    struct corpus corpus;
+    corpus_generate(&corpus, generator);
+
+    printf("%-10s %14.0f %14.0f\n", corpus.name, measure(&corpus, false),
+           measure(&corpus, true));
+
+    corpus_free(&corpus);
+  }
+
+  return ok ? 0 : 1;
+}
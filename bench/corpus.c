@@ -0,0 +1,340 @@
+#include "corpus.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PRINTF_BUFFER_SIZE 512
+
+static uint32_t random_state;
+
+static uint32_t random_next() {
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 17;
+  random_state ^= random_state << 5;
+  return random_state;
+}
+
+static uint32_t random_below(uint32_t n) { return random_next() % n; }
+
+static void put(struct corpus *corpus, const void *data, size_t size) {
+  if (corpus->size + size > corpus->capacity) {
+    while (corpus->size + size > corpus->capacity)
+      corpus->capacity = corpus->capacity ? corpus->capacity * 2 : 4096;
+
+    corpus->data = realloc(corpus->data, corpus->capacity);
+  }
+
+  memcpy(corpus->data + corpus->size, data, size);
+  corpus->size += size;
+}
+
+static void puts_corpus(struct corpus *corpus, const char *string) {
+  put(corpus, string, strlen(string));
+}
+
+static void printf_corpus(struct corpus *corpus, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+
+  char buffer[PRINTF_BUFFER_SIZE];
+  int length = vsnprintf(buffer, PRINTF_BUFFER_SIZE, format, args);
+  put(corpus, buffer,
+      length < PRINTF_BUFFER_SIZE ? length : PRINTF_BUFFER_SIZE - 1);
+
+  va_end(args);
+}
+
+static const char *const words[] = {
+    "static", "void",    "int",     "return",  "struct", "terminal",
+    "screen", "row",     "col",     "size_t",  "if",     "else",
+    "for",    "while",   "buffer",  "const",   "uint8_t", "codepoint",
+    "cells",  "render",  "cursor",  "margin",  "scroll", "->",
+    "=",      "+",       "(",       ")",       "{",      "}",
+};
+
+#define WORDS_COUNT (sizeof(words) / sizeof(words[0]))
+
+static const char *const names[] = {
+    "main.c",  "screen.c", "terminal.h", "Makefile", "README.md",
+    "lib",     "include",  "build",      "font.bdf", "crt.pio",
+    "adb.c",   "tests",    "docs",       "LICENSE",  "config.txt",
+};
+
+#define NAMES_COUNT (sizeof(names) / sizeof(names[0]))
+
+static void put_code_line(struct corpus *corpus, size_t width) {
+  size_t col = random_below(4) * 2;
+
+  for (size_t i = 0; i < col; i++)
+    puts_corpus(corpus, " ");
+
+  while (true) {
+    const char *word = words[random_below(WORDS_COUNT)];
+    size_t length = strlen(word);
+
+    if (col + length + 1 > width)
+      break;
+
+    if (random_below(5) == 0)
+      printf_corpus(corpus, "\x1b[%dm%s\x1b[m ", 32 + random_below(4), word);
+    else
+      printf_corpus(corpus, "%s ", word);
+
+    col += length + 1;
+  }
+}
+
+// Full screen redraws with line numbers, syntax colors and a status line,
+// mixed with scroll region line inserts.
+static void generate_vim(struct corpus *corpus) {
+  size_t line = 1;
+
+  while (corpus->size < CORPUS_SIZE) {
+    puts_corpus(corpus, "\x1b[?25l");
+
+    if (random_below(4) == 0) {
+      puts_corpus(corpus, "\x1b[1;23r\x1b[1;1H\x1b[3L\x1b[r");
+
+      for (size_t row = 1; row <= 3; row++) {
+        printf_corpus(corpus, "\x1b[%d;1H\x1b[33m%4d \x1b[m", row, line++);
+        put_code_line(corpus, 75);
+        puts_corpus(corpus, "\x1b[K");
+      }
+    } else {
+      puts_corpus(corpus, "\x1b[H\x1b[2J");
+
+      for (size_t row = 1; row <= 23; row++) {
+        printf_corpus(corpus, "\x1b[%d;1H\x1b[33m%4d \x1b[m", row, line++);
+        put_code_line(corpus, 75);
+        puts_corpus(corpus, "\x1b[K");
+      }
+    }
+
+    printf_corpus(corpus,
+                  "\x1b[24;1H\x1b[7m terminal_screen.c [+]%*s%d,%d  %d%% "
+                  "\x1b[27m",
+                  40, "", line, random_below(80) + 1, random_below(100));
+    printf_corpus(corpus, "\x1b[%d;%dH\x1b[?25h", random_below(23) + 1,
+                  random_below(75) + 6);
+  }
+}
+
+// Recursive long listing with ls --color directory names.
+static void generate_ls(struct corpus *corpus) {
+  size_t directory = 0;
+
+  while (corpus->size < CORPUS_SIZE) {
+    printf_corpus(corpus, "./src/module%zu/%s:\r\ntotal %d\r\n", directory++,
+                  names[random_below(NAMES_COUNT)], random_below(4096));
+
+    for (size_t entries = random_below(20) + 2; entries; entries--) {
+      bool is_directory = random_below(4) == 0;
+
+      printf_corpus(corpus, "%s 1 user staff %8d Jan %2d %02d:%02d ",
+                    is_directory ? "drwxr-xr-x" : "-rw-r--r--",
+                    random_below(1 << 20), random_below(31) + 1,
+                    random_below(24), random_below(60));
+
+      if (is_directory)
+        printf_corpus(corpus, "\x1b[01;34m%s\x1b[0m\r\n",
+                      names[random_below(NAMES_COUNT)]);
+      else
+        printf_corpus(corpus, "%s\r\n", names[random_below(NAMES_COUNT)]);
+    }
+
+    puts_corpus(corpus, "\r\n");
+  }
+}
+
+// Periodic full screen refresh of a process table.
+static void generate_top(struct corpus *corpus) {
+  while (corpus->size < CORPUS_SIZE) {
+    printf_corpus(corpus,
+                  "\x1b[H\x1b[?25ltop - %02d:%02d:%02d up 3 days,  1 user,  "
+                  "load average: %d.%02d, 0.%02d, 0.%02d\x1b[K\r\n",
+                  random_below(24), random_below(60), random_below(60),
+                  random_below(4), random_below(100), random_below(100),
+                  random_below(100));
+    printf_corpus(corpus,
+                  "Tasks: \x1b[1m%d\x1b[m total,   \x1b[1m%d\x1b[m running"
+                  "\x1b[K\r\n",
+                  random_below(300), random_below(10));
+    printf_corpus(corpus,
+                  "%%Cpu(s): \x1b[1m%2d.%d\x1b[m us, \x1b[1m%2d.%d\x1b[m sy"
+                  "\x1b[K\r\n\x1b[K\r\n",
+                  random_below(100), random_below(10), random_below(100),
+                  random_below(10));
+    puts_corpus(corpus, "\x1b[7m    PID USER      PR  NI    VIRT    RES  "
+                        "S  %CPU  %MEM     TIME+ COMMAND        \x1b[m\r\n");
+
+    for (size_t row = 6; row < 24; row++)
+      printf_corpus(corpus,
+                    "%7d user      20   0 %7d %6d %s %5d.%d %5d.%d %3d:%02d.%02d "
+                    "%-14s\x1b[K\r\n",
+                    random_below(99999), random_below(9999999),
+                    random_below(999999), random_below(3) ? "S" : "R",
+                    random_below(100), random_below(10), random_below(100),
+                    random_below(10), random_below(999), random_below(60),
+                    random_below(100), names[random_below(NAMES_COUNT)]);
+
+    puts_corpus(corpus, "\x1b[J");
+  }
+}
+
+// Compiler invocations wider than the screen and colored diagnostics.
+static void generate_compiler(struct corpus *corpus) {
+  while (corpus->size < CORPUS_SIZE) {
+    const char *name = names[random_below(NAMES_COUNT)];
+
+    printf_corpus(corpus,
+                  "arm-none-eabi-gcc -DPICO_BOARD=pico -I/home/user/pico-sdk/"
+                  "src/common/pico_stdlib/include -O2 -g -Wall -Wextra "
+                  "-std=gnu11 -o CMakeFiles/mac_terminal.dir/%s.obj -c %s\r\n",
+                  name, name);
+
+    if (random_below(3) == 0) {
+      size_t line = random_below(2000) + 1;
+      size_t col = random_below(60) + 1;
+
+      printf_corpus(corpus,
+                    "\x1b[1m%s:%zu:%zu:\x1b[m \x1b[1;35mwarning:\x1b[m unused "
+                    "variable '\x1b[1m%s\x1b[m' "
+                    "[\x1b[1;35m-Wunused-variable\x1b[m]\r\n",
+                    name, line, col, words[random_below(WORDS_COUNT)]);
+      printf_corpus(corpus, "%5zu | ", line);
+      put_code_line(corpus, 70);
+      printf_corpus(corpus, "\r\n      | %*s\x1b[1;32m^\x1b[m\r\n",
+                    (int)col - 1, "");
+    }
+  }
+}
+
+static const char *const cyrillic_words[] = {
+    "Привет",  "терминал", "экран",  "строка", "символ", "шрифт",
+    "быстро",  "медленно", "буфер",  "курсор", "данные", "прокрутка",
+    "и",       "в",        "на",     "с",      "для",    "вывод",
+};
+
+#define CYRILLIC_WORDS_COUNT (sizeof(cyrillic_words) / sizeof(cyrillic_words[0]))
+
+// cat of UTF-8 prose and tree(1) style box drawing.
+static void generate_utf8(struct corpus *corpus) {
+  while (corpus->size < CORPUS_SIZE) {
+    for (size_t lines = random_below(6) + 1; lines; lines--) {
+      size_t col = 0;
+
+      while (true) {
+        const char *word = cyrillic_words[random_below(CYRILLIC_WORDS_COUNT)];
+        size_t length = strlen(word) / 2;
+
+        if (col + length + 1 > 78)
+          break;
+
+        printf_corpus(corpus, "%s ", word);
+        col += length + 1;
+      }
+
+      puts_corpus(corpus, "\r\n");
+    }
+
+    puts_corpus(corpus, ".\r\n");
+    for (size_t entries = random_below(10) + 2; entries; entries--) {
+      for (size_t depth = random_below(4); depth; depth--)
+        puts_corpus(corpus, "│   ");
+
+      printf_corpus(corpus, "%s %s\r\n", entries == 1 ? "└──" : "├──",
+                    names[random_below(NAMES_COUNT)]);
+    }
+  }
+}
+
+// Sequences that touch the whole screen at once: clears, reverse video
+// flips, alignment fills, scroll bursts and alternate screen switches, each
+// followed by a little text.
+static void generate_screen(struct corpus *corpus) {
+  static const char *const operations[] = {
+      "\x1b[H\x1b[2J",
+      "\x1b[?5h",
+      "\x1b[?5l",
+      "\x1b#8",
+      "\x1b[24;1H\n\n\n\n\n\n\n\n\n\n\n\n",
+      "\x1b[?1049h\x1b[H",
+      "\x1b[?1049l",
+      "\x1b[1;24r\x1b[12S\x1b[r",
+  };
+
+  while (corpus->size < CORPUS_SIZE) {
+    puts_corpus(corpus,
+                operations[random_below(sizeof(operations) /
+                                        sizeof(operations[0]))]);
+    printf_corpus(corpus, "\x1b[%u;1H", 1 + random_below(24));
+    put_code_line(corpus, 78);
+  }
+}
+
+// Full screen TUI redraws inside synchronized output: each frame clears the
+// screen and draws every line, some of them twice over as a layout pass
+// settles, then scrolls the whole screen and a region inside it, before the
+// frame is let through.
+static void generate_sync(struct corpus *corpus) {
+  while (corpus->size < CORPUS_SIZE) {
+    puts_corpus(corpus, "\x1b[?2026h\x1b[H\x1b[2J");
+
+    for (size_t row = 1; row <= 24; row++) {
+      printf_corpus(corpus, "\x1b[%zu;1H", row);
+      put_code_line(corpus, 78);
+
+      if (random_below(3) == 0) {
+        printf_corpus(corpus, "\x1b[%zu;1H\x1b[2K", row);
+        put_code_line(corpus, 78);
+      }
+    }
+
+    puts_corpus(corpus, "\x1b[24;1H\n\x1b[5;10r\x1b[10;1H\n\x1b[r");
+    puts_corpus(corpus, "\x1b[?2026l");
+  }
+}
+
+const struct corpus_generator corpus_generators[] = {
+    {"vim", generate_vim},
+    {"ls-lR", generate_ls},
+    {"top", generate_top},
+    {"compiler", generate_compiler},
+    {"utf8", generate_utf8},
+    {"screen", generate_screen},
+    {"sync", generate_sync},
+    {NULL},
+};
+
+void corpus_generate(struct corpus *corpus,
+                     const struct corpus_generator *generator) {
+  memset(corpus, 0, sizeof(struct corpus));
+  corpus->name = generator->name;
+
+  random_state = 0x2545f491;
+  generator->generate(corpus);
+}
+
+bool corpus_load(struct corpus *corpus, const char *path) {
+  memset(corpus, 0, sizeof(struct corpus));
+  corpus->name = path;
+
+  FILE *file = fopen(path, "rb");
+  if (!file)
+    return false;
+
+  character_t buffer[4096];
+  size_t size;
+  while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    put(corpus, buffer, size);
+
+  fclose(file);
+  return true;
+}
+
+void corpus_free(struct corpus *corpus) {
+  free(corpus->data);
+  memset(corpus, 0, sizeof(struct corpus));
+}
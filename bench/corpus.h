@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "terminal/terminal.h"
+
+// Byte streams standing in for recorded host output. The generators are
+// deterministic so runs are comparable between builds; real captures can be
+// loaded from files instead.
+
+#define CORPUS_SIZE (128 * 1024)
+
+struct corpus {
+  const char *name;
+  character_t *data;
+  size_t size;
+  size_t capacity;
+};
+
+struct corpus_generator {
+  const char *name;
+  void (*generate)(struct corpus *corpus);
+};
+
+extern const struct corpus_generator corpus_generators[];
+
+void corpus_generate(struct corpus *corpus,
+                     const struct corpus_generator *generator);
+
+bool corpus_load(struct corpus *corpus, const char *path);
+
+void corpus_free(struct corpus *corpus);
@@ -0,0 +1,45 @@
+#include "null_callbacks.h"
+
+static void null_set_leds(struct lock_state state) {}
+
+static bool null_transmit(const character_t *characters, size_t size) {
+  return true;
+}
+
+static void null_set_rts(bool ready) {}
+
+static void null_draw_codepoint(struct format format, size_t row, size_t col,
+                                codepoint_t codepoint, enum font font,
+                                bool italic, bool underlined, bool crossedout,
+                                color_t active, color_t inactive) {}
+
+static void null_clear_rows(struct format format, size_t from_row,
+                            size_t to_row, color_t inactive) {}
+
+static void null_clear_cols(struct format format, size_t row, size_t from_col,
+                            size_t to_col, color_t inactive) {}
+
+static void null_scroll(struct format format, enum scroll scroll,
+                        size_t from_row, size_t to_row, size_t rows,
+                        color_t inactive) {}
+
+static void null_shift(struct format format, size_t row, size_t col,
+                       size_t cols, color_t inactive) {}
+
+static void null_test(struct format format, enum screen_test screen_test) {}
+
+static void null_yield() {}
+
+const struct terminal_callbacks null_callbacks = {
+    .keyboard_set_leds = null_set_leds,
+    .uart_transmit = null_transmit,
+    .uart_set_rts = null_set_rts,
+    .screen_draw_codepoint = null_draw_codepoint,
+    .screen_clear_rows = null_clear_rows,
+    .screen_clear_cols = null_clear_cols,
+    .screen_scroll = null_scroll,
+    .screen_shift_left = null_shift,
+    .screen_shift_right = null_shift,
+    .screen_test = null_test,
+    .yield = null_yield,
+};
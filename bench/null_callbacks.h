@@ -0,0 +1,8 @@
+#pragma once
+
+#include "terminal/terminal.h"
+
+// Terminal callbacks that do nothing and accept everything sent, for benches
+// that only measure the terminal itself. Benches that need to watch one of
+// them copy the set and replace it.
+extern const struct terminal_callbacks null_callbacks;
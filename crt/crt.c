@@ -5,6 +5,7 @@
 
 #include "hardware/dma.h"
 #include "hardware/clocks.h"
+#include "hardware/irq.h"
 
 #include "crt.pio.h"
 #include "crt.h"
@@ -62,56 +63,146 @@ void initVideoPIO(PIO pio, uint video_pin, uint hsync_pin, uint vsync_pin) {
   pio->txf[VIDEO_SM] = 511;
 }
 
+#define SCREEN_LINES 342
+#define LINE_BYTES 64
+
+// Each frame is sent as a list of control blocks, {transfer count, read
+// address} pairs written to the video channel, so that the text area can be
+// read as a ring starting at any line. At most four segments (top margin,
+// text from the start line, text before the start line, bottom margin) plus a
+// null block that ends the frame.
+#define VIDEO_BLOCKS 5
+
+static uint32_t video_blocks[VIDEO_BLOCKS][2] __attribute__((aligned(8)));
+
+static video_buffers *video = NULL;
+static size_t ring_first_line = 0;
+static size_t ring_lines = 0;
+static size_t ring_start_line = 0;
+
+static size_t addVideoBlock(size_t block, const uint8_t *buffer,
+                            size_t from_line, size_t to_line) {
+  if (to_line <= from_line) {
+    return block;
+  }
+
+  video_blocks[block][0] = (to_line - from_line) * LINE_BYTES / 4;
+  video_blocks[block][1] = (uint32_t)(buffer + from_line * LINE_BYTES);
+  return block + 1;
+}
+
+static void buildVideoBlocks() {
+  const uint8_t *buffer = *video->frontBuffer;
+  size_t text_end = ring_first_line + ring_lines;
+
+  size_t block = 0;
+  block = addVideoBlock(block, buffer, 0, ring_first_line);
+  block = addVideoBlock(block, buffer, ring_first_line + ring_start_line, text_end);
+  block = addVideoBlock(block, buffer, ring_first_line, ring_first_line + ring_start_line);
+  block = addVideoBlock(block, buffer, text_end, SCREEN_LINES);
+
+  video_blocks[block][0] = 0;
+  video_blocks[block][1] = 0;
+}
+
+// The null block at the end of a frame raises the interrupt instead of
+// starting the video channel. The PIO FIFO covers the restart, and the front
+// buffer and ring start are picked up here, between frames.
+static void videoDMAHandler() {
+  dma_hw->ints0 = 1u << video->videoDMAChannel;
+
+  buildVideoBlocks();
+  dma_channel_set_read_addr(video->bufferSelectDMAChannel, video_blocks, true);
+}
+
 void initVideoDMA(video_buffers *buffers) {
   int buffer_select_chan = dma_claim_unused_channel(true);
   int video_chan = dma_claim_unused_channel(true);
 
-  // Copy the address of the current front buffer to the video channel trigger
+  video = buffers;
+  buildVideoBlocks();
+
+  // Copy the next control block to the video channel count and read address
+  // trigger
   dma_channel_config buffer_select_config = dma_channel_get_default_config(buffer_select_chan);
   channel_config_set_transfer_data_size(&buffer_select_config, DMA_SIZE_32);
-  // Always copy the front buffer pointer
-  channel_config_set_read_increment(&buffer_select_config, false);
-  // Always copy to video channel trigger
-  channel_config_set_write_increment(&buffer_select_config, false);
+  channel_config_set_read_increment(&buffer_select_config, true);
+  // Wrap the write address back to the transfer count after each block
+  channel_config_set_write_increment(&buffer_select_config, true);
+  channel_config_set_ring(&buffer_select_config, true, 3);
 
   dma_channel_configure(
     buffer_select_chan,
     &buffer_select_config,
-    &dma_hw->ch[video_chan].al3_read_addr_trig, // Write to video read address trigger
-    &buffers->frontBuffer, // Read the pointer to front buffer
-    1, // Copy pointer and stop
+    &dma_hw->ch[video_chan].al3_transfer_count, // Write count, then read address trigger
+    video_blocks, // Read the first control block
+    2, // Copy one block and stop
     false // Don't start yet
   );
 
-  // Then copy the frame of video data from the buffer to the crt pio state machine
+  // Then copy the segment of video data from the buffer to the crt pio state machine
   dma_channel_config video_config = dma_channel_get_default_config(video_chan);
   channel_config_set_transfer_data_size(&video_config, DMA_SIZE_32);
   // Reverse little-endian data
   channel_config_set_bswap(&video_config, true);
   channel_config_set_read_increment(&video_config, true);
   channel_config_set_dreq(&video_config, DREQ_PIO0_TX0);
-  // And loop back to selecting front buffer
+  // And loop back to the next control block
   channel_config_set_chain_to(&video_config, buffer_select_chan);
+  // Interrupt on the null block only
+  channel_config_set_irq_quiet(&video_config, true);
 
   dma_channel_configure(
       video_chan,
       &video_config,
       &pio0_hw->txf[0], // Write address (only need to set this once)
-      NULL,             // Don't provide a read address yet
-      VIDEO_BUFFER_SIZE / 4, // Write the same value many times, then halt and interrupt
+      NULL,             // Read address and count come from the control blocks
+      0,
       false             // Don't start yet
   );
 
+  dma_channel_set_irq0_enabled(video_chan, true);
+  irq_set_exclusive_handler(DMA_IRQ_0, videoDMAHandler);
+  irq_set_enabled(DMA_IRQ_0, true);
+
   buffers->bufferSelectDMAChannel = buffer_select_chan;
   buffers->videoDMAChannel = video_chan;
 }
 
+void setVideoRing(size_t first_line, size_t lines, size_t start_line) {
+  ring_first_line = first_line;
+  ring_lines = lines;
+  ring_start_line = start_line;
+}
+
+static int scroll_chan = -1;
+
+void initScrollDMA() {
+  scroll_chan = dma_claim_unused_channel(true);
+
+  // Plain word copy between two framebuffer locations, started on demand
+  dma_channel_config scroll_config = dma_channel_get_default_config(scroll_chan);
+  channel_config_set_transfer_data_size(&scroll_config, DMA_SIZE_32);
+  channel_config_set_read_increment(&scroll_config, true);
+  channel_config_set_write_increment(&scroll_config, true);
+
+  dma_channel_set_config(scroll_chan, &scroll_config, false);
+}
+
+void scrollDMAMove(uint8_t *to, const uint8_t *from, size_t size) {
+  dma_channel_set_read_addr(scroll_chan, from, false);
+  dma_channel_set_write_addr(scroll_chan, to, false);
+  dma_channel_set_trans_count(scroll_chan, size / 4, true);
+}
+
+void scrollDMAWait() {
+  dma_channel_wait_for_finish_blocking(scroll_chan);
+}
+
 void startVideo(video_buffers *buffers, PIO pio) {
   dma_channel_start(buffers->bufferSelectDMAChannel);
   // Pre-fill PIO TX queue
-  while (
-    dma_hw->ch[buffers->videoDMAChannel].al3_transfer_count == VIDEO_BUFFER_SIZE / 4
-    ) {
+  while (!pio_sm_is_tx_fifo_full(pio, VIDEO_SM)) {
     tight_loop_contents();
   }
   pio_enable_sm_mask_in_sync(pio, 0b111);
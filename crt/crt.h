@@ -22,6 +22,10 @@ typedef struct video_buffers
 video_buffers *createVideoBuffers();
 void initVideoPIO(PIO pio, uint video_pin, uint hsync_pin, uint vsync_pin);
 void initVideoDMA(video_buffers *buffers);
+void setVideoRing(size_t first_line, size_t lines, size_t start_line);
+void initScrollDMA();
+void scrollDMAMove(uint8_t *to, const uint8_t *from, size_t size);
+void scrollDMAWait();
 void startVideo(video_buffers *buffers, PIO pio);
 void swapBuffers(video_buffers *buffers);
 
@@ -1,40 +1,144 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "font.h"
 
-static int16_t find_glyph_index(const struct bitmap_font *font,
-                                uint16_t codepoint) {
-  size_t first = 0;
-  size_t last = font->codepoints_length - 1;
-  size_t middle = (first + last) / 2;
+#define PAGE_SIZE 256
 
-  while (first <= last) {
-    if (font->codepoints[middle] == codepoint)
-      return middle;
+// Pages copied to SRAM at boot: ASCII and Latin-1, then box drawing and block
+// elements.
+static const uint8_t hot_pages[] = {0x00, 0x25};
 
-    if (font->codepoints[middle] < codepoint)
-      first = middle + 1;
-    else
-      last = middle - 1;
+static void add_resident_page(const struct bitmap_font *font, uint8_t page,
+                              size_t *used) {
+  struct glyph_residency *residency = font->residency;
 
-    middle = (first + last) / 2;
+  if (!font->pages[page] || residency->ranges_length == GLYPH_RESIDENT_RANGES)
+    return;
+
+  // Glyphs are sorted by codepoint, so a page's own glyphs are contiguous.
+  // Entries for codepoints without a glyph point elsewhere and are skipped.
+  const uint16_t *entries = font->page_entries + font->pages[page] * PAGE_SIZE;
+  uint16_t first = UINT16_MAX;
+  uint16_t last = 0;
+
+  for (size_t i = 0; i < PAGE_SIZE; i++) {
+    uint16_t index = entries[i];
+
+    if (font->codepoints[index] / PAGE_SIZE != page)
+      continue;
+
+    if (index < first)
+      first = index;
+    if (index > last)
+      last = index;
+  }
+
+  if (first > last)
+    return;
+
+  size_t size = (last - first + 1) * font->height;
+  if (*used + size > GLYPH_RESIDENT_SIZE)
+    return;
+
+  memcpy(residency->data + *used, font->data + first * font->height, size);
+
+  residency->ranges[residency->ranges_length++] = (struct glyph_range){
+      .first = first,
+      .count = last - first + 1,
+      .data = residency->data + *used,
+  };
+  *used += size;
+}
+
+void font_residency_init(const struct bitmap_font *font) {
+  struct glyph_residency *residency = font->residency;
+
+  if (!residency)
+    return;
+
+  residency->ranges_length = 0;
+  memset(residency->slot_map, 0, font->codepoints_length);
+  residency->slots_length = 0;
+  residency->clock = 0;
+  font_residency_reset_stats(font);
+
+  size_t used = 0;
+  for (size_t i = 0; i < sizeof(hot_pages); i++)
+    add_resident_page(font, hot_pages[i], &used);
+}
+
+void font_residency_get_stats(const struct bitmap_font *font,
+                              struct glyph_residency_stats *stats) {
+  if (font->residency)
+    *stats = font->residency->stats;
+  else
+    memset(stats, 0, sizeof(*stats));
+}
+
+void font_residency_reset_stats(const struct bitmap_font *font) {
+  if (font->residency)
+    memset(&font->residency->stats, 0, sizeof(font->residency->stats));
+}
+
+static const uint8_t *promote_glyph(const struct bitmap_font *font,
+                                    uint16_t index) {
+  struct glyph_residency *residency = font->residency;
+
+  if (residency->slot_map[index]) {
+    size_t slot = residency->slot_map[index] - 1;
+
+    residency->slot_used[slot] = ++residency->clock;
+    residency->stats.slot_hits++;
+    return residency->slot_data[slot];
+  }
+
+  residency->stats.misses++;
+
+  if (font->height > GLYPH_SLOT_SIZE)
+    return font->data + (index * font->height);
+
+  size_t slot = residency->slots_length;
+
+  if (slot < GLYPH_SLOTS) {
+    residency->slots_length++;
+  } else {
+    slot = 0;
+    for (size_t i = 1; i < GLYPH_SLOTS; i++)
+      if (residency->slot_used[i] < residency->slot_used[slot])
+        slot = i;
+
+    residency->slot_map[residency->slot_glyphs[slot]] = 0;
   }
 
-  return -1;
+  residency->slot_map[index] = slot + 1;
+  residency->slot_glyphs[slot] = index;
+  residency->slot_used[slot] = ++residency->clock;
+  memcpy(residency->slot_data[slot], font->data + (index * font->height),
+         font->height);
+
+  return residency->slot_data[slot];
 }
 
 const uint8_t *find_glyph(const struct bitmap_font *font,
                           uint16_t codepoint) {
-  // TODO: move null character in erus font
-  if (codepoint == 0) {
-    codepoint = 32;
-  }
+  uint16_t index = font->page_entries[font->pages[codepoint / PAGE_SIZE] *
+                                          PAGE_SIZE +
+                                      codepoint % PAGE_SIZE];
+  struct glyph_residency *residency = font->residency;
 
-  int16_t index = find_glyph_index(font, codepoint);
+  if (!residency)
+    return font->data + (index * font->height);
 
-  if (index == -1)
-    return NULL;
+  for (size_t i = 0; i < residency->ranges_length; i++) {
+    const struct glyph_range *range = &residency->ranges[i];
+
+    if ((uint16_t)(index - range->first) < range->count) {
+      residency->stats.resident_hits++;
+      return range->data + (index - range->first) * font->height;
+    }
+  }
 
-  return font->data + (index * font->height);
+  return promote_glyph(font, index);
 }
@@ -4,6 +4,60 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+// Bytes of SRAM per font for the hot pages copied in at boot.
+#ifndef GLYPH_RESIDENT_SIZE
+#define GLYPH_RESIDENT_SIZE 6144
+#endif
+
+// Glyphs outside the hot pages promoted to SRAM on demand, per font. The
+// default holds a full Cyrillic alphabet in both cases.
+#ifndef GLYPH_SLOTS
+#define GLYPH_SLOTS 80
+#endif
+
+#if GLYPH_SLOTS > 255
+#error "GLYPH_SLOTS must fit slot_map entries"
+#endif
+
+#define GLYPH_SLOT_SIZE 16
+#define GLYPH_RESIDENT_RANGES 4
+
+struct glyph_residency_stats
+{
+  uint32_t resident_hits;
+  uint32_t slot_hits;
+  uint32_t misses;
+};
+
+// Glyphs first to first + count, copied to data.
+struct glyph_range
+{
+  uint16_t first;
+  uint16_t count;
+  const uint8_t *data;
+};
+
+// SRAM copies of the glyphs that are drawn most, so that rendering does not
+// depend on the XIP cache. Hot pages are copied whole by font_residency_init
+// and any other glyph takes the least recently used slot when it is looked
+// up.
+struct glyph_residency
+{
+  struct glyph_range ranges[GLYPH_RESIDENT_RANGES];
+  size_t ranges_length;
+  uint8_t data[GLYPH_RESIDENT_SIZE];
+
+  // Slot + 1 holding each glyph index, or 0, one entry per glyph.
+  uint8_t *slot_map;
+  uint16_t slot_glyphs[GLYPH_SLOTS];
+  uint32_t slot_used[GLYPH_SLOTS];
+  uint8_t slot_data[GLYPH_SLOTS][GLYPH_SLOT_SIZE];
+  size_t slots_length;
+  uint32_t clock;
+
+  struct glyph_residency_stats stats;
+};
+
 struct bitmap_font
 {
   uint32_t height;
@@ -11,10 +65,26 @@ struct bitmap_font
   const uint8_t *data;
   uint32_t codepoints_length;
   const uint16_t *codepoints;
+  // Two-level glyph index: pages maps the high byte of a codepoint to a page
+  // of 256 page_entries, indexed by the low byte.
+  const uint8_t *pages;
+  const uint16_t *page_entries;
+  struct glyph_residency *residency;
 };
 
+// Returns the glyph for codepoint, or the replacement glyph if the font has
+// none.
 const uint8_t *find_glyph(const struct bitmap_font *font, uint16_t codepoint);
 
+// Copies the ASCII, Latin-1 and box-drawing pages to SRAM and empties the
+// slots.
+void font_residency_init(const struct bitmap_font *font);
+
+void font_residency_get_stats(const struct bitmap_font *font,
+                              struct glyph_residency_stats *stats);
+
+void font_residency_reset_stats(const struct bitmap_font *font);
+
 extern const struct bitmap_font normal_font;
 extern const struct bitmap_font bold_font;
 
@@ -2,9 +2,16 @@
 
 import sys
 import argparse
-from bdfparser import Font
+
+try:
+    from bdfparser import Font
+except ImportError:
+    Font = None
 
 def compile_font(fontfile):
+    if Font is None:
+        return read_font(fontfile)
+
     font = Font(fontfile)
 
     glyphs = [glyph for glyph in font.iterglyphs()]
@@ -24,14 +31,109 @@ def compile_font(fontfile):
         'codepoints': codepoints,
     }
 
+# Minimal BDF reader used when bdfparser is not installed (e.g. for the host
+# build). Produces the same rows as bdfparser's draw().todata(4): each glyph
+# is placed in the font bounding box and every row is a right-aligned hex
+# string of fbbx bits.
+def read_font(fontfile):
+    fbbx = fbby = fbbxoff = fbbyoff = 0
+    glyphs = {}
+
+    with open(fontfile) as f:
+        lines = iter(f.read().splitlines())
+
+    for line in lines:
+        fields = line.split()
+        if not fields:
+            continue
+
+        if fields[0] == 'FONTBOUNDINGBOX':
+            fbbx, fbby, fbbxoff, fbbyoff = (int(x) for x in fields[1:5])
+        elif fields[0] == 'STARTCHAR':
+            cp = None
+            bbw = bbh = bbxoff = bbyoff = 0
+            rows = []
+
+            for line in lines:
+                fields = line.split()
+                if fields[0] == 'ENCODING':
+                    cp = int(fields[1])
+                elif fields[0] == 'BBX':
+                    bbw, bbh, bbxoff, bbyoff = (int(x) for x in fields[1:5])
+                elif fields[0] == 'BITMAP':
+                    for line in lines:
+                        if line.strip() == 'ENDCHAR':
+                            break
+                        rows.append(line.strip())
+                    break
+
+            bitmap = [0] * fbby
+            top = (fbby + fbbyoff) - (bbyoff + bbh)
+            shift = fbbx - (bbxoff - fbbxoff) - bbw
+
+            for i, row in enumerate(rows):
+                y = top + i
+                if 0 <= y < fbby:
+                    bits = int(row, 16) >> (len(row) * 4 - bbw)
+                    bitmap[y] = (bits << shift if shift >= 0 else bits >> -shift) & ((1 << fbbx) - 1)
+
+            if cp is not None and cp >= 0:
+                glyphs[cp] = bitmap
+
+    digits = (fbbx + 3) // 4
+    codepoints = sorted(glyphs)
+
+    return {
+        'height': fbby,
+        'width': fbbx,
+        'data': ['{:0{}x}'.format(row, digits) for cp in codepoints for row in glyphs[cp]],
+        'codepoints_length': len(codepoints),
+        'codepoints': codepoints,
+    }
+
+PAGE_SIZE = 256
+PAGE_COUNT = 0x10000 // PAGE_SIZE
+
+# Two-level lookup table over the BMP: the high byte of a codepoint selects a
+# page and the low byte an entry holding the glyph index. Page 0 is shared by
+# every page without glyphs, and codepoints without a glyph resolve to the
+# replacement glyph, so a lookup is always two loads.
+def compile_pages(font, replacement):
+    index = {cp: i for i, cp in enumerate(font['codepoints']) if cp < 0x10000}
+    missing = index[replacement]
+
+    # TODO: move null character in erus font
+    index[0] = index[0x20]
+
+    pages = [0] * PAGE_COUNT
+    entries = [missing] * PAGE_SIZE
+
+    for page in range(PAGE_COUNT):
+        base = page * PAGE_SIZE
+        if not any(cp in index for cp in range(base, base + PAGE_SIZE)):
+            continue
+
+        pages[page] = len(entries) // PAGE_SIZE
+        entries += [index.get(cp, missing) for cp in range(base, base + PAGE_SIZE)]
+
+    return pages, entries
+
 def format_bytes_literal(b):
     return '{{0x{data}}}'.format(data=',0x'.join(b))
 
 def format_ints_literal(i):
     return '{{{data}}}'.format(data=','.join(str(x) for x in i))
 
+def format_pages(prefix, pages, entries):
+    return (
+        f'const uint8_t {prefix}glyph_pages[{len(pages)}] = {format_ints_literal(pages)};\n'
+        f'const uint16_t {prefix}glyph_page_entries[{len(entries)}] = {format_ints_literal(entries)};\n'
+    )
+
 def main(args):
+    replacement = args['replacement']
     normal_font = compile_font(args['font'])
+    normal_pages = compile_pages(normal_font, replacement)
 
     count = normal_font['codepoints_length']
     glyph_literal = format_bytes_literal(normal_font['data'])
@@ -42,12 +144,18 @@ def main(args):
         '#include "font.h"\n\n'
         f'const uint8_t glyph_data[{count * normal_font["height"]}] = {glyph_literal};\n'
         f'const uint16_t codepoints[{count}] = {codepoints_literal};\n'
+        + format_pages('', *normal_pages) +
+        f'uint8_t normal_slot_map[{count}];\n'
+        'struct glyph_residency normal_residency = {.slot_map = normal_slot_map};\n'
         'const struct bitmap_font normal_font = {\n'
         f'  .height = {normal_font["height"]},\n'
         f'  .width = {normal_font["width"]},\n'
         '  .data = (const uint8_t *) glyph_data,\n'
         f'  .codepoints_length = {count},\n'
         '  .codepoints = (const uint16_t *) codepoints,\n'
+        '  .pages = glyph_pages,\n'
+        '  .page_entries = glyph_page_entries,\n'
+        '  .residency = &normal_residency,\n'
         '};\n\n'
     )
 
@@ -59,23 +167,39 @@ def main(args):
             '  .data = (const uint8_t *) glyph_data,\n'
             f'  .codepoints_length = {count},\n'
             '  .codepoints = (const uint16_t *) codepoints,\n'
+            '  .pages = glyph_pages,\n'
+            '  .page_entries = glyph_page_entries,\n'
+            '  .residency = &normal_residency,\n'
             '};'
         )
     else:
         bold_font = compile_font(args['bold'])
+        bold_pages = compile_pages(bold_font, replacement)
         count = bold_font['codepoints_length']
         glyph_literal = format_bytes_literal(bold_font['data'])
         codepoints_literal = format_ints_literal(bold_font['codepoints'])
 
+        # Both weights usually cover the same codepoints, in which case the
+        # page table is shared.
+        pages_prefix = ''
+        if bold_pages != normal_pages:
+            pages_prefix = 'bold_'
+
         out += (
             f'const uint8_t bold_glyph_data[{count * bold_font["height"]}] = {glyph_literal};\n'
             f'const uint16_t bold_codepoints[{count}] = {codepoints_literal};\n'
+            + (format_pages(pages_prefix, *bold_pages) if pages_prefix else '') +
+            f'uint8_t bold_slot_map[{count}];\n'
+            'struct glyph_residency bold_residency = {.slot_map = bold_slot_map};\n'
             'const struct bitmap_font bold_font = {\n'
             f'  .height = {bold_font["height"]},\n'
             f'  .width = {bold_font["width"]},\n'
             '  .data = (const uint8_t *) bold_glyph_data,\n'
             f'  .codepoints_length = {count},\n'
             '  .codepoints = (const uint16_t *) bold_codepoints,\n'
+            f'  .pages = {pages_prefix}glyph_pages,\n'
+            f'  .page_entries = {pages_prefix}glyph_page_entries,\n'
+            '  .residency = &bold_residency,\n'
             '};'
         )
 
@@ -86,6 +210,7 @@ if __name__ == "__main__":
     parser = argparse.ArgumentParser(description='Generate a C file from a BDF font file')
     parser.add_argument('--bold', '-b', help='an optional bold variant bdf file', default=None)
     parser.add_argument('--outfile', '-o', help='file to output', default='font_data.c')
+    parser.add_argument('--replacement', '-r', help='codepoint drawn for codepoints without a glyph', type=lambda x: int(x, 0), default=0x20)
     parser.add_argument('font', help='the font to convert')
     args = parser.parse_args()
     main(vars(args))
@@ -0,0 +1,152 @@
+#include "pico/stdlib.h"
+#include "hardware/irq.h"
+#include "hardware/uart.h"
+
+#include <string.h>
+#include <time.h>
+
+#define UART_FIFO_SIZE 32
+#define IRQ_COUNT 32
+
+struct uart_inst {
+  unsigned int irq;
+  unsigned int baudrate;
+  bool fifo_enabled;
+  bool rx_irq_enabled;
+  bool tx_irq_enabled;
+
+  uint8_t rx_fifo[UART_FIFO_SIZE];
+  size_t rx_head;
+  size_t rx_size;
+
+  uint8_t tx_fifo[UART_FIFO_SIZE];
+  size_t tx_head;
+  size_t tx_size;
+};
+
+uart_inst_t host_uart0 = {.irq = UART0_IRQ};
+uart_inst_t host_uart1 = {.irq = UART1_IRQ};
+
+static irq_handler_t irq_handlers[IRQ_COUNT];
+static bool irq_enabled[IRQ_COUNT];
+
+uint64_t time_us_64(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+uint32_t time_us_32(void) { return (uint32_t)time_us_64(); }
+
+void sleep_us(uint64_t us) {
+  struct timespec ts = {.tv_sec = us / 1000000,
+                        .tv_nsec = (us % 1000000) * 1000};
+  nanosleep(&ts, NULL);
+}
+
+void sleep_ms(uint32_t ms) { sleep_us((uint64_t)ms * 1000); }
+
+void irq_set_exclusive_handler(unsigned int num, irq_handler_t handler) {
+  if (num < IRQ_COUNT)
+    irq_handlers[num] = handler;
+}
+
+void irq_set_enabled(unsigned int num, bool enabled) {
+  if (num < IRQ_COUNT)
+    irq_enabled[num] = enabled;
+}
+
+static void raise_irq(unsigned int num) {
+  if (num < IRQ_COUNT && irq_enabled[num] && irq_handlers[num])
+    irq_handlers[num]();
+}
+
+static size_t fifo_depth(uart_inst_t *uart) {
+  return uart->fifo_enabled ? UART_FIFO_SIZE : 1;
+}
+
+unsigned int uart_init(uart_inst_t *uart, unsigned int baudrate) {
+  memset(uart->rx_fifo, 0, UART_FIFO_SIZE);
+  memset(uart->tx_fifo, 0, UART_FIFO_SIZE);
+  uart->rx_head = uart->rx_size = 0;
+  uart->tx_head = uart->tx_size = 0;
+  uart->fifo_enabled = true;
+  uart->baudrate = baudrate;
+
+  return baudrate;
+}
+
+void uart_set_hw_flow(uart_inst_t *uart, bool cts, bool rts) {}
+
+void uart_set_format(uart_inst_t *uart, unsigned int data_bits,
+                     unsigned int stop_bits, uart_parity_t parity) {}
+
+void uart_set_fifo_enabled(uart_inst_t *uart, bool enabled) {
+  uart->fifo_enabled = enabled;
+}
+
+void uart_set_irq_enables(uart_inst_t *uart, bool rx_has_data,
+                          bool tx_needs_data) {
+  uart->rx_irq_enabled = rx_has_data;
+  uart->tx_irq_enabled = tx_needs_data;
+}
+
+bool uart_is_writable(uart_inst_t *uart) {
+  return uart->tx_size < fifo_depth(uart);
+}
+
+bool uart_is_readable(uart_inst_t *uart) { return uart->rx_size > 0; }
+
+void uart_putc_raw(uart_inst_t *uart, char c) {
+  if (!uart_is_writable(uart))
+    return;
+
+  uart->tx_fifo[(uart->tx_head + uart->tx_size) % UART_FIFO_SIZE] = c;
+  uart->tx_size++;
+}
+
+char uart_getc(uart_inst_t *uart) {
+  if (!uart->rx_size)
+    return 0;
+
+  char c = uart->rx_fifo[uart->rx_head];
+  uart->rx_head = (uart->rx_head + 1) % UART_FIFO_SIZE;
+  uart->rx_size--;
+
+  return c;
+}
+
+size_t host_uart_push_rx(uart_inst_t *uart, const uint8_t *data, size_t size) {
+  size_t pushed = 0;
+
+  while (pushed < size) {
+    while (pushed < size && uart->rx_size < fifo_depth(uart)) {
+      uart->rx_fifo[(uart->rx_head + uart->rx_size) % UART_FIFO_SIZE] =
+          data[pushed++];
+      uart->rx_size++;
+    }
+
+    if (!uart->rx_irq_enabled)
+      break;
+
+    raise_irq(uart->irq);
+
+    if (uart->rx_size == fifo_depth(uart))
+      break;
+  }
+
+  return pushed;
+}
+
+size_t host_uart_pop_tx(uart_inst_t *uart, uint8_t *data, size_t size) {
+  size_t popped = 0;
+
+  while (popped < size && uart->tx_size) {
+    data[popped++] = uart->tx_fifo[uart->tx_head];
+    uart->tx_head = (uart->tx_head + 1) % UART_FIFO_SIZE;
+    uart->tx_size--;
+  }
+
+  return popped;
+}
@@ -0,0 +1,551 @@
+#include "host.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <string.h>
+
+#include "fonts/font.h"
+#include "pico/stdlib.h"
+#include "ring/ring.h"
+#include "serial/serial_rx.h"
+#include "terminal/screen_queue.h"
+
+// Host counterpart of the glue in main.c: the same screens, callbacks and
+// buffers, with the CRT replaced by a plain video buffer and the UART by the
+// host stand-in.
+
+#define UART_ID uart0
+
+#define CHAR_HEIGHT 11
+#define CHAR_WIDTH 6
+
+#define MAX_COLS 80
+#define MAX_ROWS 30
+#define TAB_STOPS_SIZE (MAX_COLS / 8)
+
+#define LOCAL_BUFFER_SIZE 64
+
+// Match SERIAL_RX_BUF_SIZE and SERIAL_RX_CHUNK_SIZE in main.c.
+#define HOST_RX_BUF_SIZE 8192
+#define HOST_RX_CHUNK_SIZE 64
+
+#define LINE_BYTES 64
+#define LINES (VIDEO_BUFFER_SIZE / LINE_BYTES)
+
+static video_buffers buffers;
+
+static struct screen screen_24_rows = {
+    .format =
+        {
+            .rows = 24,
+            .cols = 80,
+        },
+    .char_width = CHAR_WIDTH,
+    .char_height = CHAR_HEIGHT,
+    .buffer = NULL,
+    .normal_bitmap_font = &normal_font,
+    .bold_bitmap_font = &bold_font,
+};
+
+static struct screen screen_30_rows = {
+    .format =
+        {
+            .rows = 30,
+            .cols = 80,
+        },
+    .char_width = CHAR_WIDTH,
+    .char_height = CHAR_HEIGHT,
+    .buffer = NULL,
+    .normal_bitmap_font = &normal_font,
+    .bold_bitmap_font = &bold_font,
+};
+
+// Stand-in for the scroll DMA channel. The copy is only carried out when the
+// move is waited for, which is the latest point real hardware could finish it,
+// so any screen access that is not fenced properly shows up as a wrong frame.
+static uint8_t *move_to = NULL;
+static const uint8_t *move_from = NULL;
+static size_t move_size = 0;
+
+static void move(uint8_t *to, const uint8_t *from, size_t size) {
+  move_to = to;
+  move_from = from;
+  move_size = size;
+}
+
+static void move_wait() {
+  if (move_size) {
+    memmove(move_to, move_from, move_size);
+    move_size = 0;
+  }
+}
+
+static const struct screen_move_backend move_backend = {
+    .move = move,
+    .wait = move_wait,
+};
+
+// Stand-in for the video DMA ring: records where the text area starts so that
+// the displayed frame can be put together in the same order as the CRT reads
+// it.
+static size_t ring_first_line = 0;
+static size_t ring_lines = 0;
+static size_t ring_start_line = 0;
+
+static uint8_t displayed_frame[VIDEO_BUFFER_SIZE];
+
+static void set_ring_start(size_t first_line, size_t lines,
+                           size_t start_line) {
+  ring_first_line = first_line;
+  ring_lines = lines;
+  ring_start_line = start_line;
+}
+
+static const struct screen_ring_backend ring_backend = {
+    .set_start = set_ring_start,
+};
+
+static struct visual_cell visual_cells[MAX_ROWS * MAX_COLS];
+static uint8_t tab_stops[TAB_STOPS_SIZE];
+
+static uint8_t transmit_buffer_data[HOST_TX_BUF_SIZE];
+static struct ring transmit_buffer;
+
+// Stand-in for the receive DMA ring in main.c: host_receive plays the part of
+// the DMA channel, writing into the ring and advancing the write offset.
+static uint8_t rx_buffer[HOST_RX_BUF_SIZE];
+static size_t rx_write_offset = 0;
+
+static size_t rx_producer_offset() { return rx_write_offset; }
+
+static const struct serial_rx_transport rx_producer = {
+    .write_offset = rx_producer_offset,
+};
+
+static struct serial_rx serial_rx;
+
+static character_t local_buffer_data[LOCAL_BUFFER_SIZE];
+static struct ring local_buffer;
+
+static struct terminal terminal;
+static struct terminal_config *host_config = NULL;
+static bool reset_requested = false;
+
+struct terminal_config_ui *global_terminal_config_ui = NULL;
+static struct terminal_config_ui terminal_config_ui;
+
+static struct screen *get_screen(struct format format) {
+  if (format.cols == 80) {
+    if (format.rows == 24)
+      return &screen_24_rows;
+    else if (format.rows == 30)
+      return &screen_30_rows;
+  }
+
+  return NULL;
+}
+
+static void (*yield_hook)() = NULL;
+
+void host_yield() {
+  // The host drains the transmit ring by polling where main.c uses the UART
+  // interrupt.
+  uint8_t character;
+  while (uart_is_writable(UART_ID) && ring_pop(&transmit_buffer, &character))
+    uart_putc_raw(UART_ID, character);
+
+  if (yield_hook)
+    yield_hook();
+}
+
+void host_set_yield_hook(void (*hook)()) { yield_hook = hook; }
+
+static bool uart_transmit(const character_t *characters, size_t size) {
+  // Nothing drains the host UART behind our back, so waiting for room is
+  // draining it once.
+  if (ring_space(&transmit_buffer) < size)
+    host_yield();
+
+  if (!ring_write_all(&transmit_buffer, characters, size))
+    return false;
+
+  if (!terminal.send_receive_mode)
+    ring_write(&local_buffer, characters, size);
+
+  return true;
+}
+
+// Stand-in for core 1: a thread that drains the render queue. While it runs,
+// the screen callbacks queue their operations instead of drawing directly, and
+// everything that looks at the frame syncs with the queue first.
+static struct screen_queue render_queue;
+static pthread_t render_thread;
+static atomic_bool render_thread_running = false;
+static bool render_thread_active = false;
+
+static void *render_main(void *arg) {
+  while (atomic_load(&render_thread_running))
+    if (!screen_queue_execute(&render_queue))
+      sched_yield();
+
+  return NULL;
+}
+
+static void render_queue_wait() {
+  host_yield();
+  sched_yield();
+}
+
+static void render_queue_notify() {}
+
+// As main.c does, straight into the FIFO ahead of the transmit ring.
+static bool uart_transmit_flow(character_t character) {
+  if (!uart_is_writable(UART_ID))
+    return false;
+
+  uart_putc_raw(UART_ID, character);
+
+  return true;
+}
+
+static void uart_set_rts(bool ready) {}
+
+static void screen_draw_codepoint_callback(struct format format, size_t row,
+                                           size_t col, codepoint_t codepoint,
+                                           enum font font, bool italic,
+                                           bool underlined, bool crossedout,
+                                           color_t active, color_t inactive) {
+  if (render_thread_active)
+    screen_queue_draw_codepoint(&render_queue, get_screen(format), row, col,
+                                codepoint, font, italic, underlined,
+                                crossedout, active, inactive);
+  else
+    screen_draw_codepoint(get_screen(format), row, col, codepoint, font,
+                          italic, underlined, crossedout, active, inactive);
+}
+
+static void screen_draw_run_callback(struct format format, size_t row,
+                                     size_t col, const codepoint_t *codepoints,
+                                     size_t count, enum font font, bool italic,
+                                     bool underlined, bool crossedout,
+                                     color_t active, color_t inactive) {
+  if (render_thread_active)
+    screen_queue_draw_run(&render_queue, get_screen(format), row, col,
+                          codepoints, count, font, italic, underlined,
+                          crossedout, active, inactive);
+  else
+    screen_draw_run(get_screen(format), row, col, codepoints, count, font,
+                    italic, underlined, crossedout, active, inactive);
+}
+
+static void screen_clear_rows_callback(struct format format, size_t from_row,
+                                       size_t to_row, color_t inactive) {
+  if (render_thread_active)
+    screen_queue_clear_rows(&render_queue, get_screen(format), from_row,
+                            to_row, inactive);
+  else
+    screen_clear_rows(get_screen(format), from_row, to_row, inactive,
+                      host_yield);
+}
+
+static void screen_clear_cols_callback(struct format format, size_t row,
+                                       size_t from_col, size_t to_col,
+                                       color_t inactive) {
+  if (render_thread_active)
+    screen_queue_clear_cols(&render_queue, get_screen(format), row, from_col,
+                            to_col, inactive);
+  else
+    screen_clear_cols(get_screen(format), row, from_col, to_col, inactive,
+                      host_yield);
+}
+
+static void screen_scroll_callback(struct format format, enum scroll scroll,
+                                   size_t from_row, size_t to_row, size_t rows,
+                                   color_t inactive) {
+  if (render_thread_active)
+    screen_queue_scroll(&render_queue, get_screen(format), scroll, from_row,
+                        to_row, rows, inactive);
+  else
+    screen_scroll(get_screen(format), scroll, from_row, to_row, rows,
+                  inactive, host_yield);
+}
+
+static void screen_shift_right_callback(struct format format, size_t row,
+                                        size_t col, size_t cols,
+                                        color_t inactive) {
+  if (render_thread_active)
+    screen_queue_shift_right(&render_queue, get_screen(format), row, col, cols,
+                             inactive);
+  else
+    screen_shift_right(get_screen(format), row, col, cols, inactive,
+                       host_yield);
+}
+
+static void screen_shift_left_callback(struct format format, size_t row,
+                                       size_t col, size_t cols,
+                                       color_t inactive) {
+  if (render_thread_active)
+    screen_queue_shift_left(&render_queue, get_screen(format), row, col, cols,
+                            inactive);
+  else
+    screen_shift_left(get_screen(format), row, col, cols, inactive,
+                      host_yield);
+}
+
+static void screen_test_callback(struct format format,
+                                 enum screen_test screen_test) {
+  struct screen *screen = get_screen(format);
+  enum font font = screen_test == SCREEN_TEST_FONT2 ? FONT_BOLD : FONT_NORMAL;
+
+  if (render_thread_active)
+    screen_queue_test_fonts(&render_queue, screen, font);
+  else
+    screen_test_fonts(screen, font);
+}
+
+static void keyboard_set_leds_callback(struct lock_state state) {}
+
+static void reset_callback() { reset_requested = true; }
+
+static void activate_config() {
+  terminal_config_ui_activate(global_terminal_config_ui);
+}
+
+static void write_config(struct terminal_config *terminal_config_copy) {
+  memcpy(host_config, terminal_config_copy, sizeof(struct terminal_config));
+}
+
+static const struct terminal_callbacks callbacks = {
+    .keyboard_set_leds = keyboard_set_leds_callback,
+    .uart_transmit = uart_transmit,
+    .uart_transmit_flow = uart_transmit_flow,
+    .uart_set_rts = uart_set_rts,
+    .screen_draw_codepoint = screen_draw_codepoint_callback,
+    .screen_draw_run = screen_draw_run_callback,
+    .screen_clear_rows = screen_clear_rows_callback,
+    .screen_clear_cols = screen_clear_cols_callback,
+    .screen_scroll = screen_scroll_callback,
+    .screen_shift_left = screen_shift_left_callback,
+    .screen_shift_right = screen_shift_right_callback,
+    .screen_test = screen_test_callback,
+    .reset = reset_callback,
+    .yield = host_yield,
+    .activate_config = activate_config,
+    .write_config = write_config};
+
+void host_default_config(struct terminal_config *config) {
+  *config = (struct terminal_config){
+      .format_rows = FORMAT_24_ROWS,
+      .monochrome_transform = MONOCHROME_TRANSFORM_LUMINANCE,
+
+      .baud_rate = BAUD_RATE_115200,
+      .stop_bits = STOP_BITS_1,
+      .parity = PARITY_NONE,
+
+      .charset = CHARSET_UTF8,
+      .keyboard_compatibility = KEYBOARD_COMPATIBILITY_PC,
+      .keyboard_layout = KEYBOARD_LAYOUT_US,
+      .receive_c1_mode = C1_MODE_8BIT,
+      .transmit_c1_mode = C1_MODE_7BIT,
+
+      .auto_wrap_mode = true,
+      .screen_mode = false,
+
+      .send_receive_mode = true,
+
+      .new_line_mode = false,
+      .cursor_key_mode = false,
+      .auto_repeat_mode = true,
+      .ansi_mode = true,
+      .backspace_mode = false,
+      .application_keypad_mode = false,
+
+      .flow_control = FLOW_CONTROL_XON_XOFF,
+
+      .start_up = START_UP_NONE,
+  };
+}
+
+struct terminal *host_init(struct terminal_config *config) {
+  host_config = config;
+  reset_requested = false;
+
+  host_use_render_thread(false);
+  host_wait_move();
+
+  memset(&buffers, 0, sizeof(buffers));
+  buffers.frontBuffer = &buffers.buffer1;
+  buffers.backBuffer = &buffers.buffer2;
+  font_residency_init(&normal_font);
+  font_residency_init(&bold_font);
+
+  screen_24_rows.buffer = screen_30_rows.buffer = *buffers.frontBuffer;
+  screen_24_rows.move_backend = screen_30_rows.move_backend = NULL;
+  screen_24_rows.ring_backend = screen_30_rows.ring_backend = NULL;
+  screen_24_rows.row_offset = screen_30_rows.row_offset = 0;
+  set_ring_start(0, 0, 0);
+
+  ring_init(&transmit_buffer, transmit_buffer_data, HOST_TX_BUF_SIZE);
+  ring_init(&local_buffer, local_buffer_data, LOCAL_BUFFER_SIZE);
+  serial_rx_init(&serial_rx, rx_buffer, HOST_RX_BUF_SIZE, &rx_producer);
+
+  uart_init(UART_ID, terminal_config_get_baud_rate(config));
+
+  terminal_init(&terminal, &callbacks, visual_cells, tab_stops,
+                TAB_STOPS_SIZE, config);
+  terminal_uart_set_receive_buffer_size(&terminal, HOST_RX_BUF_SIZE);
+
+  global_terminal_config_ui = &terminal_config_ui;
+  terminal_config_ui_init(&terminal_config_ui, &terminal, config);
+
+  return &terminal;
+}
+
+void host_receive(const character_t *characters, size_t size) {
+  while (size) {
+    // Produce: copy as much as fits into the ring the way the receive DMA
+    // channel would, then publish as rx_task does.
+    size_t space = HOST_RX_BUF_SIZE - 1 - serial_rx_available(&serial_rx);
+    size_t produced = size < space ? size : space;
+
+    for (size_t i = 0; i < produced; i++)
+      rx_buffer[(rx_write_offset + i) % HOST_RX_BUF_SIZE] = characters[i];
+
+    rx_write_offset = (rx_write_offset + produced) % HOST_RX_BUF_SIZE;
+    characters += produced;
+    size -= produced;
+
+    serial_rx_publish(&serial_rx);
+
+    // Consume as the main loop does.
+    const uint8_t *chunk_data;
+    size_t chunk;
+
+    while ((chunk = serial_rx_peek(&serial_rx, &chunk_data,
+                                   HOST_RX_CHUNK_SIZE)) > 0) {
+      terminal_uart_receive_buffer(&terminal, chunk_data, chunk);
+      serial_rx_consume(&serial_rx, chunk);
+
+      // Echo what the terminal sent in local mode, but not what echoing that
+      // sends in turn.
+      size_t local_size = ring_available(&local_buffer);
+      while (local_size > 0) {
+        const uint8_t *local_data;
+        size_t local_chunk = ring_peek_contiguous(&local_buffer, &local_data);
+        if (local_chunk > local_size)
+          local_chunk = local_size;
+
+        terminal_uart_receive_buffer(&terminal, local_data, local_chunk);
+        ring_commit(&local_buffer, local_chunk);
+        local_size -= local_chunk;
+      }
+
+      host_yield();
+
+      if (reset_requested)
+        host_init(host_config);
+    }
+  }
+}
+
+struct screen *host_screen() { return get_screen(terminal.format); }
+
+void host_use_move_backend(bool use) {
+  host_wait_move();
+
+  screen_24_rows.move_backend = screen_30_rows.move_backend =
+      use ? &move_backend : NULL;
+}
+
+void host_use_ring_backend(bool use) {
+  screen_24_rows.ring_backend = screen_30_rows.ring_backend =
+      use ? &ring_backend : NULL;
+}
+
+void host_use_render_thread(bool use) {
+  if (use == render_thread_active)
+    return;
+
+  if (use) {
+    host_wait_move();
+
+    screen_queue_init(&render_queue, render_queue_wait, render_queue_notify);
+    atomic_store(&render_thread_running, true);
+    pthread_create(&render_thread, NULL, render_main, NULL);
+  } else {
+    screen_queue_sync(&render_queue);
+
+    atomic_store(&render_thread_running, false);
+    pthread_join(render_thread, NULL);
+  }
+
+  render_thread_active = use;
+}
+
+void host_wait_move() {
+  if (render_thread_active)
+    screen_queue_sync(&render_queue);
+
+  if (screen_24_rows.move_backend)
+    screen_wait_move(&screen_24_rows);
+
+  if (screen_30_rows.move_backend)
+    screen_wait_move(&screen_30_rows);
+}
+
+uint8_t *host_video_buffer() {
+  host_wait_move();
+
+  const uint8_t *buffer = *buffers.frontBuffer;
+  size_t text = ring_first_line * LINE_BYTES;
+  size_t text_size = ring_lines * LINE_BYTES;
+  size_t start = ring_start_line * LINE_BYTES;
+
+  memcpy(displayed_frame, buffer, VIDEO_BUFFER_SIZE);
+  memcpy(displayed_frame + text, buffer + text + start, text_size - start);
+  memcpy(displayed_frame + text + text_size - start, buffer + text, start);
+
+  return displayed_frame;
+}
+
+size_t host_transmitted(character_t *characters, size_t size) {
+  size_t transmitted = 0;
+
+  while (transmitted < size) {
+    host_yield();
+
+    size_t popped = host_uart_pop_tx(UART_ID, characters + transmitted,
+                                     size - transmitted);
+    if (!popped)
+      break;
+
+    transmitted += popped;
+  }
+
+  return transmitted;
+}
+
+uint32_t host_digest() {
+  // FNV-1a over the visible frame.
+  uint32_t hash = 2166136261u;
+
+  const uint8_t *frame = host_video_buffer();
+
+  for (size_t i = 0; i < VIDEO_BUFFER_SIZE; i++) {
+    hash ^= frame[i];
+    hash *= 16777619u;
+  }
+
+  return hash;
+}
+
+void host_write_pbm(FILE *file) {
+  fprintf(file, "P4\n%d %d\n", LINE_BYTES * 8, LINES);
+
+  const uint8_t *frame = host_video_buffer();
+
+  // PBM marks black pixels with ones, the video buffer marks lit ones.
+  for (size_t i = 0; i < VIDEO_BUFFER_SIZE; i++)
+    fputc((uint8_t)~frame[i], file);
+}
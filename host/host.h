@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdio.h>
+
+#include "crt/crt.h"
+#include "terminal/screen.h"
+#include "terminal/terminal.h"
+#include "terminal/terminal_config_ui.h"
+
+#define HOST_TX_BUF_SIZE 256
+
+void host_default_config(struct terminal_config *config);
+
+struct terminal *host_init(struct terminal_config *config);
+
+void host_receive(const character_t *characters, size_t size);
+
+void host_yield();
+
+// Called from host_yield, where main.c runs the scheduler's preempting tasks.
+void host_set_yield_hook(void (*hook)());
+
+struct screen *host_screen();
+
+void host_use_move_backend(bool use);
+
+void host_use_ring_backend(bool use);
+
+// Hands screen operations to a second thread, as core 1 takes them off core 0
+// on the device.
+void host_use_render_thread(bool use);
+
+void host_wait_move();
+
+uint8_t *host_video_buffer();
+
+size_t host_transmitted(character_t *characters, size_t size);
+
+uint32_t host_digest();
+
+void host_write_pbm(FILE *file);
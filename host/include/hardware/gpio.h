@@ -0,0 +1,23 @@
+#ifndef HARDWARE_GPIO_HEADER
+#define HARDWARE_GPIO_HEADER
+
+#include <stdbool.h>
+
+#define GPIO_OUT 1
+#define GPIO_IN 0
+
+enum gpio_function {
+  GPIO_FUNC_UART = 2,
+  GPIO_FUNC_PIO0 = 6,
+  GPIO_FUNC_PIO1 = 7,
+  GPIO_FUNC_NULL = 0x1f,
+};
+
+static inline void gpio_init(unsigned int gpio) {}
+static inline void gpio_set_dir(unsigned int gpio, bool out) {}
+static inline void gpio_put(unsigned int gpio, bool value) {}
+static inline void gpio_pull_up(unsigned int gpio) {}
+static inline void gpio_set_function(unsigned int gpio,
+                                     enum gpio_function fn) {}
+
+#endif
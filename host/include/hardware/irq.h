@@ -0,0 +1,14 @@
+#ifndef HARDWARE_IRQ_HEADER
+#define HARDWARE_IRQ_HEADER
+
+#include <stdbool.h>
+
+#define UART0_IRQ 20
+#define UART1_IRQ 21
+
+typedef void (*irq_handler_t)(void);
+
+void irq_set_exclusive_handler(unsigned int num, irq_handler_t handler);
+void irq_set_enabled(unsigned int num, bool enabled);
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef HARDWARE_PIO_HEADER
+#define HARDWARE_PIO_HEADER
+
+#include "pico/stdlib.h"
+
+typedef struct pio_hw pio_hw_t;
+typedef pio_hw_t *PIO;
+
+#endif
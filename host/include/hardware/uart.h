@@ -0,0 +1,40 @@
+#ifndef HARDWARE_UART_HEADER
+#define HARDWARE_UART_HEADER
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct uart_inst uart_inst_t;
+
+extern uart_inst_t host_uart0;
+extern uart_inst_t host_uart1;
+
+#define uart0 (&host_uart0)
+#define uart1 (&host_uart1)
+
+typedef enum {
+  UART_PARITY_NONE,
+  UART_PARITY_EVEN,
+  UART_PARITY_ODD,
+} uart_parity_t;
+
+unsigned int uart_init(uart_inst_t *uart, unsigned int baudrate);
+void uart_set_hw_flow(uart_inst_t *uart, bool cts, bool rts);
+void uart_set_format(uart_inst_t *uart, unsigned int data_bits,
+                     unsigned int stop_bits, uart_parity_t parity);
+void uart_set_fifo_enabled(uart_inst_t *uart, bool enabled);
+void uart_set_irq_enables(uart_inst_t *uart, bool rx_has_data,
+                          bool tx_needs_data);
+
+bool uart_is_writable(uart_inst_t *uart);
+bool uart_is_readable(uart_inst_t *uart);
+void uart_putc_raw(uart_inst_t *uart, char c);
+char uart_getc(uart_inst_t *uart);
+
+// Host only: the other end of the wire. Pushing received bytes runs the
+// registered RX interrupt handler the same way the hardware would.
+size_t host_uart_push_rx(uart_inst_t *uart, const uint8_t *data, size_t size);
+size_t host_uart_pop_tx(uart_inst_t *uart, uint8_t *data, size_t size);
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef PICO_STDLIB_HEADER
+#define PICO_STDLIB_HEADER
+
+// Host stand-in for the pico-sdk header: only the parts this tree uses.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef unsigned int uint;
+
+#include "hardware/gpio.h"
+#include "hardware/uart.h"
+
+static inline void tight_loop_contents(void) {}
+
+uint64_t time_us_64(void);
+uint32_t time_us_32(void);
+
+void sleep_us(uint64_t us);
+void sleep_ms(uint32_t ms);
+
+#endif
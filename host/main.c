@@ -0,0 +1,71 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "host.h"
+
+// Runs the terminal core on the host: feeds a recorded byte stream (a file or
+// stdin) through the parser and renderer and dumps the resulting video buffer
+// as a PBM image.
+
+#define READ_BUFFER_SIZE 4096
+
+static void usage(const char *name) {
+  fprintf(stderr, "usage: %s [-r 24|30] [-o output.pbm] [input]\n", name);
+}
+
+int main(int argc, char **argv) {
+  struct terminal_config config;
+  host_default_config(&config);
+
+  const char *input = NULL;
+  const char *output = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+      config.format_rows =
+          strcmp(argv[++i], "30") == 0 ? FORMAT_30_ROWS : FORMAT_24_ROWS;
+    } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      output = argv[++i];
+    } else if (argv[i][0] == '-' && argv[i][1]) {
+      usage(argv[0]);
+      return 1;
+    } else {
+      input = argv[i];
+    }
+  }
+
+  FILE *in = stdin;
+  if (input && strcmp(input, "-") != 0) {
+    in = fopen(input, "rb");
+    if (!in) {
+      perror(input);
+      return 1;
+    }
+  }
+
+  host_init(&config);
+
+  character_t buffer[READ_BUFFER_SIZE];
+  size_t size;
+  while ((size = fread(buffer, 1, READ_BUFFER_SIZE, in)) > 0)
+    host_receive(buffer, size);
+
+  if (in != stdin)
+    fclose(in);
+
+  FILE *out = stdout;
+  if (output) {
+    out = fopen(output, "wb");
+    if (!out) {
+      perror(output);
+      return 1;
+    }
+  }
+
+  host_write_pbm(out);
+
+  if (out != stdout)
+    fclose(out);
+
+  return 0;
+}
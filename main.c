@@ -7,8 +7,11 @@
 #include <string.h>
 
 #include "pico/stdlib.h"
+#include "pico/multicore.h"
 #include "hardware/uart.h"
+#include "hardware/dma.h"
 #include "hardware/irq.h"
+#include "hardware/sync.h"
 #include "hardware/watchdog.h"
 
 #include "crt/crt.h"
@@ -18,30 +21,58 @@
 #include "fonts/font_data.h"
 
 #include "terminal/screen.h"
+#include "terminal/screen_queue.h"
 #include "terminal/terminal.h"
 #include "terminal/terminal_config_ui.h"
 #include "terminal/keys.h"
 #include "adb/keyboard.h"
-
-#define SERIAL_RX_BUF_SIZE 8192
-char SerialRxBuf[SERIAL_RX_BUF_SIZE];
-volatile int SerialRxBufHead = 0;
-volatile int SerialRxBufTail = 0;
-
-#define SERIAL_TX_BUF_SIZE 64
-char SerialTxBuf[SERIAL_TX_BUF_SIZE];
-int SerialTxBufHead = 0;
-int SerialTxBufTail = 0;
+#include "ring/ring.h"
+#include "scheduler/scheduler.h"
+#include "serial/serial_rx.h"
+
+// Filled by the receive DMA channel, which wraps its write address on the
+// buffer size, so the buffer has to be aligned to it.
+#define SERIAL_RX_BUF_SIZE_BITS 13
+#define SERIAL_RX_BUF_SIZE (1 << SERIAL_RX_BUF_SIZE_BITS)
+uint8_t SerialRxBuf[SERIAL_RX_BUF_SIZE]
+    __attribute__((aligned(SERIAL_RX_BUF_SIZE)));
+static int serial_rx_dma_chan = -1;
+static struct serial_rx serial_rx;
+
+#define SERIAL_RX_CHUNK_SIZE 64
+
+// Cells rasterised between checks of the flush task's deadline, about three
+// rows.
+#define FLUSH_SLICE_CELLS 240
+
+// Screen operations yield at least once a row, so a scancode waits no longer
+// than this, one row of work and the keyboard task's own budget.
+#define YIELD_INTERVAL_US 1000
+
+// Drained into the UART FIFO by the UART interrupt.
+#define SERIAL_TX_BUF_SIZE 256
+
+// How long uart_transmit waits for room in the buffer before giving up.
+#define UART_TRANSMIT_WAIT_US 2000
+
+static uint8_t serial_tx_buffer_data[SERIAL_TX_BUF_SIZE];
+static struct ring serial_tx_buffer;
+
+// What keys send while serial_tx_buffer is full, held here rather than waited
+// for, so that scancodes are still decoded with CTS held off. The keyboard
+// task moves it on as the host takes more.
+#define KEY_TRANSMIT_SIZE 64
+static uint8_t key_transmit_buffer_data[KEY_TRANSMIT_SIZE];
+static struct ring key_transmit_buffer;
+static bool keyboard_transmitting;
 
 #define LOCAL_BUFFER_SIZE 64
-static character_t local_buffer[LOCAL_BUFFER_SIZE];
-static size_t local_head = 0;
-static size_t local_tail = 0;
+static character_t local_buffer_data[LOCAL_BUFFER_SIZE];
+static struct ring local_buffer;
 
 #define KEYBOARD_BUFFER_SIZE 256
-uint8_t keyboard_buffer[KEYBOARD_BUFFER_SIZE];
-volatile int keyboard_buffer_head = 0;
-volatile int keyboard_buffer_tail = 0;
+static uint8_t keyboard_buffer_data[KEYBOARD_BUFFER_SIZE];
+static struct ring keyboard_buffer;
 
 struct keyboard global_keyboard;
 
@@ -55,6 +86,11 @@ struct keyboard global_keyboard;
 
 #define UART_TX_PIN 0
 #define UART_RX_PIN 1
+// The UART0 functions of GPIO 2 and 3 are taken by the sync outputs. RTS is
+// driven by hand: with the receive DMA emptying the FIFO, the UART's own RTS
+// would never tell the host to stop.
+#define UART_CTS_PIN 14
+#define UART_RTS_PIN 15
 
 static struct screen screen_24_rows = {
     .format =
@@ -82,6 +118,19 @@ static struct screen screen_30_rows = {
     .bold_bitmap_font = &bold_font,
 };
 
+static const struct screen_move_backend scroll_dma = {
+    .move = scrollDMAMove,
+    .wait = scrollDMAWait,
+};
+
+static const struct screen_ring_backend video_ring = {
+    .set_start = setVideoRing,
+};
+
+// Screen operations on their way from the parser on core 0 to the rasteriser
+// on core 1.
+static struct screen_queue render_queue;
+
 #define MAX_COLS 80
 #define MAX_ROWS 30
 #define TAB_STOPS_SIZE (MAX_COLS / 8)
@@ -132,87 +181,249 @@ struct terminal_config terminal_config = {
     .backspace_mode = false,
     .application_keypad_mode = false,
 
-    .flow_control = true,
+    .flow_control = FLOW_CONTROL_XON_XOFF,
 
     .start_up = START_UP_MESSAGE,
 };
 
-void yield() {
-  if (keyboard_buffer_tail != keyboard_buffer_head) {
-    uint8_t scancode = keyboard_buffer[keyboard_buffer_tail];
-    keyboard_buffer_tail++;
+static struct scheduler scheduler;
 
-    if (keyboard_buffer_tail == KEYBOARD_BUFFER_SIZE) {
-      keyboard_buffer_tail = 0;
-    }
+// Long screen operations call this as often as they like; the scheduler only
+// steps in once a yield interval has passed, to handle the keyboard.
+void yield() { scheduler_yield(&scheduler); }
+
+// Lets the interrupt handler, the only consumer, start filling the FIFO.
+static void serial_tx_start() {
+  irq_set_pending(UART_ID == uart0 ? UART0_IRQ : UART1_IRQ);
+}
+
+static bool keyboard_task(uint64_t deadline_us) {
+  if (!global_terminal)
+    return false;
+
+  const uint8_t *data;
+  size_t size;
+  while ((size = ring_peek_contiguous(&key_transmit_buffer, &data)) > 0) {
+    size_t written = ring_write(&serial_tx_buffer, data, size);
+    ring_commit(&key_transmit_buffer, written);
+    if (written > 0)
+      serial_tx_start();
+    if (written < size)
+      break;
+  }
+
+  keyboard_transmitting = true;
 
+  uint8_t scancode;
+  while (ring_pop(&keyboard_buffer, &scancode)) {
     keyboard_handle_code(&global_keyboard, scancode);
-    if (global_terminal) {
-      terminal_keyboard_handle_key(
-          global_terminal, global_keyboard.lshift || global_keyboard.rshift,
-          global_keyboard.lalt, global_keyboard.ralt,
-          global_keyboard.lctrl || global_keyboard.rctrl, global_keyboard.keys[0]);
+    terminal_keyboard_handle_key(
+        global_terminal, global_keyboard.lshift || global_keyboard.rshift,
+        global_keyboard.lalt, global_keyboard.ralt,
+        global_keyboard.lctrl || global_keyboard.rctrl, global_keyboard.keys[0]);
+
+    if (time_us_64() >= deadline_us) {
+      keyboard_transmitting = false;
+      return ring_available(&keyboard_buffer) > 0;
     }
   }
-  
-  while(uart_is_writable(UART_ID) && SerialTxBufTail != SerialTxBufHead) { // while Tx is free and there is data to send
-    uart_putc_raw(UART_ID, SerialTxBuf[SerialTxBufTail++]);// send the byte
-    SerialTxBufTail = SerialTxBufTail % SERIAL_TX_BUF_SIZE; // advance the tail of the queue
+
+  terminal_keyboard_repeat_key(global_terminal);
+
+  keyboard_transmitting = false;
+  return false;
+}
+
+// Makes what the DMA channel has written visible and tells the host whether
+// to hold off. This is the only publisher: the channel keeps the RX FIFO
+// empty, so there is never anything for a receive timeout to report.
+static bool rx_task(uint64_t deadline_us) {
+  if (global_terminal_config_ui->activated)
+    return false;
+
+  serial_rx_publish(&serial_rx);
+  terminal_uart_flow_control(global_terminal,
+                             serial_rx_available(&serial_rx));
+
+  return false;
+}
+
+// Echoes what the terminal sent in local mode, but not what echoing that
+// sends in turn.
+static bool tx_task(uint64_t deadline_us) {
+  if (global_terminal_config_ui->activated)
+    return false;
+
+  size_t size = ring_available(&local_buffer);
+  while (size > 0) {
+    const uint8_t *data;
+    size_t chunk = ring_peek_contiguous(&local_buffer, &data);
+    if (chunk > size)
+      chunk = size;
+
+    terminal_uart_receive_buffer(global_terminal, data, chunk);
+    ring_commit(&local_buffer, chunk);
+    size -= chunk;
   }
+
+  return false;
 }
 
-static void uart_transmit(character_t *characters, size_t size, size_t head) {
-  if (!global_terminal->send_receive_mode) {
-    while (size--) {
-      local_buffer[local_head] = *characters;
-      local_head++;
-      characters++;
+// Hands the parser contiguous spans of the ring rather than single bytes so
+// that runs of printable text are drawn in one go, until the budget runs out.
+static bool parse_task(uint64_t deadline_us) {
+  if (global_terminal_config_ui->activated)
+    return false;
 
-      if (local_head == LOCAL_BUFFER_SIZE)
-        local_head = 0;
-    }
+  size_t size = serial_rx_available(&serial_rx);
+
+  while (size > 0 && !global_terminal_config_ui->activated &&
+         time_us_64() < deadline_us) {
+    const uint8_t *chunk_data;
+    size_t chunk =
+        serial_rx_peek(&serial_rx, &chunk_data, SERIAL_RX_CHUNK_SIZE);
+    if (chunk > size)
+      chunk = size;
+
+    terminal_uart_receive_buffer(global_terminal, chunk_data, chunk);
+    serial_rx_consume(&serial_rx, chunk);
+
+    size -= chunk;
+    terminal_uart_flow_control(global_terminal, size);
+    yield();
   }
 
-  SerialTxBufHead = head;
+  return size > 0;
+}
+
+static bool flush_task(uint64_t deadline_us) {
+  while (terminal_screen_flush_slice(global_terminal, FLUSH_SLICE_CELLS))
+    if (time_us_64() >= deadline_us)
+      return true;
+
+  return false;
+}
+
+static bool cursor_task(uint64_t deadline_us) {
+  terminal_screen_update(global_terminal);
+
+  return false;
 }
 
+// Highest priority first. The keyboard comes first and may preempt the rest
+// at their yields; parsing and flushing get budgets so that neither can shut
+// the other out when the line is busy.
+static struct scheduler_task tasks[] = {
+    {.name = "keyboard", .run = keyboard_task, .budget_us = 200,
+     .preempts = true},
+    {.name = "rx", .run = rx_task},
+    {.name = "tx", .run = tx_task},
+    {.name = "parse", .run = parse_task, .budget_us = 2000},
+    {.name = "flush", .run = flush_task, .budget_us = 2000},
+    {.name = "cursor", .run = cursor_task, .period_us = 1000},
+};
+
+static bool uart_transmit(const character_t *characters, size_t size) {
+  struct ring *ring = &serial_tx_buffer;
+
+  if (keyboard_transmitting) {
+    // Keys never wait, and queue behind any held back before them.
+    if (ring_available(&key_transmit_buffer) > 0 ||
+        ring_space(&serial_tx_buffer) < size)
+      ring = &key_transmit_buffer;
+  } else {
+    // Only briefly: at low rates, or with CTS held off, the buffer can take
+    // far longer to drain than the rest of the main loop can wait.
+    uint64_t deadline = time_us_64() + UART_TRANSMIT_WAIT_US;
+
+    while (ring_space(&serial_tx_buffer) < size && time_us_64() < deadline)
+      tight_loop_contents();
+  }
+
+  if (!ring_write_all(ring, characters, size))
+    return false;
+
+  if (!global_terminal->send_receive_mode)
+    ring_write(&local_buffer, characters, size);
+
+  if (ring == &serial_tx_buffer)
+    serial_tx_start();
+
+  return true;
+}
+
+// XON and XOFF go straight into the FIFO, ahead of whatever the interrupt
+// handler still has to send, so that the host hears them in time. Interrupts
+// are held off so the handler cannot fill the FIFO in between.
+static bool uart_transmit_flow(character_t character) {
+  uint32_t interrupts = save_and_disable_interrupts();
+  bool writable = uart_is_writable(UART_ID);
+
+  if (writable)
+    uart_putc_raw(UART_ID, character);
+
+  restore_interrupts(interrupts);
+
+  return writable;
+}
+
+// RTS is active low.
+static void uart_set_rts(bool ready) { gpio_put(UART_RTS_PIN, !ready); }
+
+static void render_queue_notify() { __sev(); }
+
 static void screen_draw_codepoint_callback(struct format format, size_t row,
                                            size_t col, codepoint_t codepoint,
                                            enum font font, bool italic,
                                            bool underlined, bool crossedout,
                                            color_t active, color_t inactive) {
-  screen_draw_codepoint(get_screen(format), row, col, codepoint, font,
-                        italic, underlined, crossedout, active, inactive);
+  screen_queue_draw_codepoint(&render_queue, get_screen(format), row, col,
+                              codepoint, font, italic, underlined, crossedout,
+                              active, inactive);
+}
+
+static void screen_draw_run_callback(struct format format, size_t row,
+                                     size_t col, const codepoint_t *codepoints,
+                                     size_t count, enum font font, bool italic,
+                                     bool underlined, bool crossedout,
+                                     color_t active, color_t inactive) {
+  screen_queue_draw_run(&render_queue, get_screen(format), row, col,
+                        codepoints, count, font, italic, underlined,
+                        crossedout, active, inactive);
 }
 
 static void screen_clear_rows_callback(struct format format, size_t from_row,
                                        size_t to_row, color_t inactive) {
-  screen_clear_rows(get_screen(format), from_row, to_row, inactive, yield);
+  screen_queue_clear_rows(&render_queue, get_screen(format), from_row, to_row,
+                          inactive);
 }
 
 static void screen_clear_cols_callback(struct format format, size_t row,
                                        size_t from_col, size_t to_col,
                                        color_t inactive) {
-  screen_clear_cols(get_screen(format), row, from_col, to_col, inactive, yield);
+  screen_queue_clear_cols(&render_queue, get_screen(format), row, from_col,
+                          to_col, inactive);
 }
 
 static void screen_scroll_callback(struct format format, enum scroll scroll,
                                    size_t from_row, size_t to_row, size_t rows,
                                    color_t inactive) {
-  screen_scroll(get_screen(format), scroll, from_row, to_row, rows, inactive,
-                yield);
+  screen_queue_scroll(&render_queue, get_screen(format), scroll, from_row,
+                      to_row, rows, inactive);
 }
 
 static void screen_shift_right_callback(struct format format, size_t row,
                                         size_t col, size_t cols,
                                         color_t inactive) {
-  screen_shift_right(get_screen(format), row, col, cols, inactive, yield);
+  screen_queue_shift_right(&render_queue, get_screen(format), row, col, cols,
+                           inactive);
 }
 
 static void screen_shift_left_callback(struct format format, size_t row,
                                        size_t col, size_t cols,
                                        color_t inactive) {
-  screen_shift_left(get_screen(format), row, col, cols, inactive, yield);
+  screen_queue_shift_left(&render_queue, get_screen(format), row, col, cols,
+                          inactive);
 }
 
 static void screen_test_callback(struct format format,
@@ -220,14 +431,29 @@ static void screen_test_callback(struct format format,
   struct screen *screen = get_screen(format);
   switch (screen_test) {
   case SCREEN_TEST_FONT1:
-    screen_test_fonts(screen, FONT_NORMAL);
+    screen_queue_test_fonts(&render_queue, screen, FONT_NORMAL);
     break;
   case SCREEN_TEST_FONT2:
-    screen_test_fonts(screen, FONT_BOLD);
+    screen_queue_test_fonts(&render_queue, screen, FONT_BOLD);
     break;
   }
 }
 
+// Core 1 rasterises: it owns the framebuffer and the font residency slots,
+// and carries out screen operations in the order core 0 queued them. Once the
+// queue runs dry it finishes any scroll still in flight and sleeps until core
+// 0 queues more.
+static void render_main() {
+  while (true) {
+    if (screen_queue_execute(&render_queue))
+      continue;
+
+    screen_wait_move(&screen_24_rows);
+    screen_wait_move(&screen_30_rows);
+    __wfe();
+  }
+}
+
 static void activate_config() {
   terminal_config_ui_activate(global_terminal_config_ui);
 }
@@ -254,11 +480,76 @@ void initTimer() {
   add_repeating_timer_ms(-1, repeating_timer_callback, NULL, &timer);
 }
 
-void on_uart_rx() {
-  while (uart_is_readable(UART_ID)) {
-    SerialRxBuf[SerialRxBufHead++]  = uart_getc(UART_ID); // store the byte in the ring buffer
-    if(SerialRxBufHead >= SERIAL_RX_BUF_SIZE) SerialRxBufHead = 0;
+static size_t serial_rx_dma_offset() {
+  return dma_channel_hw_addr(serial_rx_dma_chan)->write_addr -
+         (uintptr_t)SerialRxBuf;
+}
+
+static const struct serial_rx_transport serial_rx_dma = {
+    .write_offset = serial_rx_dma_offset,
+};
+
+// Moves queued bytes into the TX FIFO. The FIFO interrupt stays unmasked only
+// while bytes are left over, so an idle transmitter costs nothing; uart_transmit
+// raises the interrupt by hand to get it going again.
+static void serial_tx_drain() {
+  const uint8_t *data;
+  size_t size;
+
+  while ((size = ring_peek_contiguous(&serial_tx_buffer, &data)) > 0) {
+    size_t sent = 0;
+    while (sent < size && uart_is_writable(UART_ID))
+      uart_putc_raw(UART_ID, data[sent++]);
+
+    ring_commit(&serial_tx_buffer, sent);
+
+    if (sent < size) {
+      hw_set_bits(&uart_get_hw(UART_ID)->imsc, UART_UARTIMSC_TXIM_BITS);
+      return;
+    }
   }
+
+  hw_clear_bits(&uart_get_hw(UART_ID)->imsc, UART_UARTIMSC_TXIM_BITS);
+}
+
+// Refills the TX FIFO; receiving is left to the DMA channel and rx_task.
+void on_uart_irq() {
+  uart_get_hw(UART_ID)->icr = UART_UARTICR_TXIC_BITS;
+  serial_tx_drain();
+}
+
+// The channel counts down from the largest transfer count; rearm it in the
+// unlikely event that runs out. The write address carries on round the ring.
+static void serialRxDMAHandler() {
+  dma_hw->ints1 = 1u << serial_rx_dma_chan;
+  dma_channel_set_trans_count(serial_rx_dma_chan, UINT32_MAX, true);
+}
+
+static void initSerialRxDMA() {
+  serial_rx_dma_chan = dma_claim_unused_channel(true);
+
+  // Bytes from the UART data register into the ring, paced by the UART
+  dma_channel_config config = dma_channel_get_default_config(serial_rx_dma_chan);
+  channel_config_set_transfer_data_size(&config, DMA_SIZE_8);
+  channel_config_set_read_increment(&config, false);
+  channel_config_set_write_increment(&config, true);
+  channel_config_set_ring(&config, true, SERIAL_RX_BUF_SIZE_BITS);
+  channel_config_set_dreq(&config, uart_get_dreq(UART_ID, false));
+
+  dma_channel_configure(
+      serial_rx_dma_chan,
+      &config,
+      SerialRxBuf,
+      &uart_get_hw(UART_ID)->dr,
+      UINT32_MAX,
+      true
+  );
+
+  dma_channel_set_irq1_enabled(serial_rx_dma_chan, true);
+  irq_set_exclusive_handler(DMA_IRQ_1, serialRxDMAHandler);
+  irq_set_enabled(DMA_IRQ_1, true);
+
+  serial_rx_init(&serial_rx, SerialRxBuf, SERIAL_RX_BUF_SIZE, &serial_rx_dma);
 }
 
 void initSerial(void) {
@@ -290,37 +581,48 @@ void initSerial(void) {
   int baud = terminal_config_get_baud_rate(&terminal_config);
 
   uart_init(UART_ID, baud);
-  uart_set_hw_flow(UART_ID, false, false);
   uart_set_format(UART_ID, data_bits, stop_bits, parity);
-  uart_set_fifo_enabled(UART_ID, false);
+  uart_set_fifo_enabled(UART_ID, true);
 
   gpio_set_function(UART_TX_PIN, GPIO_FUNC_UART);
   gpio_set_function(UART_RX_PIN, GPIO_FUNC_UART);
 
+  if (terminal_config.flow_control == FLOW_CONTROL_RTS_CTS) {
+    uart_set_hw_flow(UART_ID, true, false);
+    gpio_set_function(UART_CTS_PIN, GPIO_FUNC_UART);
+
+    gpio_init(UART_RTS_PIN);
+    gpio_set_dir(UART_RTS_PIN, GPIO_OUT);
+    uart_set_rts(true);
+  } else {
+    uart_set_hw_flow(UART_ID, false, false);
+  }
+
   int UART_IRQ = UART_ID == uart0 ? UART0_IRQ : UART1_IRQ;
 
-  irq_set_exclusive_handler(UART_IRQ, on_uart_rx);
+  initSerialRxDMA();
+
+  irq_set_exclusive_handler(UART_IRQ, on_uart_irq);
   irq_set_enabled(UART_IRQ, true);
 
-  uart_set_irq_enables(UART_ID, true, false);
+  // Nothing on the receive side: the DMA channel takes the bytes. The TX FIFO
+  // interrupt is unmasked by serial_tx_drain while there is more to send.
+  uart_get_hw(UART_ID)->imsc = 0;
 }
 
 void adb_handler(uint8_t address, uint8_t reg, uint8_t *data, size_t len) {
   if (address == 2 && reg == 0) {
-    for (size_t i = 0; i < len; i++) {
-      keyboard_buffer[keyboard_buffer_head] = data[i];
-      keyboard_buffer_head++;
-
-      if (keyboard_buffer_head == KEYBOARD_BUFFER_SIZE) {
-        keyboard_buffer_head = 0;
-      }
-    }
+    ring_write(&keyboard_buffer, data, len);
   }
 }
 
 int main() {
 
   keyboard_init(&global_keyboard);
+  ring_init(&keyboard_buffer, keyboard_buffer_data, KEYBOARD_BUFFER_SIZE);
+  ring_init(&local_buffer, local_buffer_data, LOCAL_BUFFER_SIZE);
+  ring_init(&serial_tx_buffer, serial_tx_buffer_data, SERIAL_TX_BUF_SIZE);
+  ring_init(&key_transmit_buffer, key_transmit_buffer_data, KEY_TRANSMIT_SIZE);
 
   // ADB
   PIO adb_pio = pio1;
@@ -343,32 +645,38 @@ int main() {
   video_buffers *buffers = createVideoBuffers();
   initVideoPIO(video_pio, video_pin, hsync_pin, vsync_pin);
   initVideoDMA(buffers);
+  initScrollDMA();
   startVideo(buffers, video_pio);
 
-#define LINE_BYTES 64
-
   memset(buffers->frontBuffer, 0, VIDEO_BUFFER_SIZE);
-  for (int y = 0; y < 342; y++) {
-    if (y > 36 && y < 305) {
-      (*buffers->frontBuffer)[y * LINE_BYTES + 1] = 0b00000100;
-      (*buffers->frontBuffer)[(y + 1) * LINE_BYTES - 2] = 0b00100000;
-    }
-    if (y == 36 || y == 305) {
-      (*buffers->frontBuffer)[y * LINE_BYTES + 1] = 0b00000111;
-      (*buffers->frontBuffer)[(y + 1) * LINE_BYTES - 2] = 0b11100000;
-      for (int x = 2; x < LINE_BYTES - 2; x++) {
-        (*buffers->frontBuffer)[x + y * LINE_BYTES] = 0xFF;
-      }
-    }
-  }
+
+  font_residency_init(&normal_font);
+  font_residency_init(&bold_font);
 
   screen_24_rows.buffer = screen_30_rows.buffer = *buffers->frontBuffer;
+  // The format only changes across a reset, so the border is drawn once for
+  // the one in use.
+  screen_draw_border(terminal_config.format_rows == FORMAT_30_ROWS
+                         ? &screen_30_rows
+                         : &screen_24_rows);
+  screen_24_rows.move_backend = screen_30_rows.move_backend = &scroll_dma;
+  screen_24_rows.ring_backend = screen_30_rows.ring_backend = &video_ring;
+
+  scheduler_init(&scheduler, tasks, sizeof(tasks) / sizeof(tasks[0]),
+                 time_us_64, YIELD_INTERVAL_US);
+
+  // While core 1 catches up, core 0 keeps the keyboard going.
+  screen_queue_init(&render_queue, yield, render_queue_notify);
+  multicore_launch_core1(render_main);
 
   struct terminal terminal;
   struct terminal_callbacks callbacks = {
       .keyboard_set_leds = keyboard_set_leds_callback,
       .uart_transmit = uart_transmit,
+      .uart_transmit_flow = uart_transmit_flow,
+      .uart_set_rts = uart_set_rts,
       .screen_draw_codepoint = screen_draw_codepoint_callback,
+      .screen_draw_run = screen_draw_run_callback,
       .screen_clear_rows = screen_clear_rows_callback,
       .screen_clear_cols = screen_clear_cols_callback,
       .screen_scroll = screen_scroll_callback,
@@ -380,8 +688,10 @@ int main() {
       .activate_config = activate_config,
       .write_config = write_config};
   terminal_init(&terminal, &callbacks, visual_cells, tab_stops, TAB_STOPS_SIZE,
-                &terminal_config, SerialTxBuf, SERIAL_TX_BUF_SIZE);
+                &terminal_config);
   global_terminal = &terminal;
+  terminal_screen_set_deferred_render(&terminal, true);
+  terminal_uart_set_receive_buffer_size(&terminal, SERIAL_RX_BUF_SIZE);
 
   initTimer();
   initSerial();
@@ -390,58 +700,6 @@ int main() {
   global_terminal_config_ui = &terminal_config_ui;
   terminal_config_ui_init(&terminal_config_ui, &terminal, &terminal_config);
 
-  while (true) {
-    yield();
-
-    terminal_screen_update(&terminal);
-    terminal_keyboard_repeat_key(&terminal);
-
-    if (terminal_config_ui.activated)
-      continue;
-
-    if (local_tail != local_head) {
-      size_t size = 0;
-      if (local_tail < local_head)
-        size = local_head - local_tail;
-      else
-        size = local_head + (LOCAL_BUFFER_SIZE - local_tail);
-
-      while (size--) {
-        character_t character = local_buffer[local_tail];
-        terminal_uart_receive_character(&terminal, character);
-        local_tail++;
-
-        if (local_tail == LOCAL_BUFFER_SIZE)
-          local_tail = 0;
-      }
-    }
-
-    if (SerialRxBufHead != SerialRxBufTail) {
-      int size = 0;
-      if (SerialRxBufTail < SerialRxBufHead)
-        size = SerialRxBufHead - SerialRxBufTail;
-      else
-        size = SerialRxBufHead + (SERIAL_RX_BUF_SIZE - SerialRxBufTail);
-
-      terminal_uart_flow_control(&terminal, size);
-
-      while (size--) {
-        yield();
-
-        if (terminal_config_ui.activated)
-          break;
-
-        terminal_uart_flow_control(&terminal, size);
-
-        character_t character = SerialRxBuf[SerialRxBufTail];
-        SerialRxBufTail++;
-
-        terminal_uart_receive_character(&terminal, character);
-        if (SerialRxBufTail == SERIAL_RX_BUF_SIZE)
-          SerialRxBufTail = 0;
-      }
-    } else {
-      terminal_uart_flow_control(&terminal, 0);
-    }
-  }
+  while (true)
+    scheduler_run(&scheduler);
 }
@@ -0,0 +1,127 @@
+#include "ring.h"
+
+#include <string.h>
+
+void ring_init(struct ring *ring, uint8_t *buffer, size_t size) {
+  ring->buffer = buffer;
+  ring->size = size;
+  atomic_init(&ring->head, 0);
+  atomic_init(&ring->tail, 0);
+  atomic_init(&ring->dropped, 0);
+}
+
+static void drop(struct ring *ring, size_t size) {
+  // Only the producer writes the count.
+  size_t dropped = atomic_load_explicit(&ring->dropped, memory_order_relaxed);
+
+  atomic_store_explicit(&ring->dropped, dropped + size, memory_order_relaxed);
+}
+
+size_t ring_space(const struct ring *ring) {
+  size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+  return ring->size - (head - tail);
+}
+
+bool ring_push(struct ring *ring, uint8_t byte) {
+  if (!ring_space(ring)) {
+    drop(ring, 1);
+    return false;
+  }
+
+  size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+  ring->buffer[head & (ring->size - 1)] = byte;
+  atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+
+  return true;
+}
+
+size_t ring_write(struct ring *ring, const uint8_t *data, size_t size) {
+  size_t space = ring_space(ring);
+
+  if (size > space) {
+    drop(ring, size - space);
+    size = space;
+  }
+
+  size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  size_t offset = head & (ring->size - 1);
+  size_t first = ring->size - offset;
+
+  if (first > size)
+    first = size;
+
+  memcpy(ring->buffer + offset, data, first);
+  memcpy(ring->buffer, data + first, size - first);
+  atomic_store_explicit(&ring->head, head + size, memory_order_release);
+
+  return size;
+}
+
+bool ring_write_all(struct ring *ring, const uint8_t *data, size_t size) {
+  if (size > ring_space(ring)) {
+    drop(ring, size);
+    return false;
+  }
+
+  ring_write(ring, data, size);
+
+  return true;
+}
+
+size_t ring_reserve_contiguous(struct ring *ring, uint8_t **data) {
+  size_t space = ring_space(ring);
+  size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  size_t offset = head & (ring->size - 1);
+
+  *data = ring->buffer + offset;
+
+  return space < ring->size - offset ? space : ring->size - offset;
+}
+
+void ring_publish(struct ring *ring, size_t size) {
+  size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+  atomic_store_explicit(&ring->head, head + size, memory_order_release);
+}
+
+size_t ring_available(const struct ring *ring) {
+  size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+  size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+  return head - tail;
+}
+
+bool ring_pop(struct ring *ring, uint8_t *byte) {
+  if (!ring_available(ring))
+    return false;
+
+  size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+  *byte = ring->buffer[tail & (ring->size - 1)];
+  atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+
+  return true;
+}
+
+size_t ring_peek_contiguous(const struct ring *ring, const uint8_t **data) {
+  size_t available = ring_available(ring);
+  size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  size_t offset = tail & (ring->size - 1);
+
+  *data = ring->buffer + offset;
+
+  return available < ring->size - offset ? available : ring->size - offset;
+}
+
+void ring_commit(struct ring *ring, size_t size) {
+  size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+  atomic_store_explicit(&ring->tail, tail + size, memory_order_release);
+}
+
+size_t ring_dropped(const struct ring *ring) {
+  return atomic_load_explicit(&ring->dropped, memory_order_relaxed);
+}
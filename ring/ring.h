@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Single producer, single consumer byte ring. The producer and the consumer
+// may run on different cores or one of them in an interrupt handler: each
+// side only ever stores its own index, with release ordering, and loads the
+// other with acquire ordering, so no read-modify-write atomics are needed.
+// Writes that do not fit are dropped and counted rather than overwriting
+// unread data.
+struct ring {
+  uint8_t *buffer;
+  // A power of two.
+  size_t size;
+
+  // Free-running counts of bytes written and read; only their difference and
+  // their low bits matter.
+  atomic_size_t head;
+  atomic_size_t tail;
+
+  // Bytes the producer had to drop because the ring was full.
+  atomic_size_t dropped;
+};
+
+void ring_init(struct ring *ring, uint8_t *buffer, size_t size);
+
+// Producer side.
+
+size_t ring_space(const struct ring *ring);
+
+bool ring_push(struct ring *ring, uint8_t byte);
+
+// Writes as much of data as fits and returns how much that was.
+size_t ring_write(struct ring *ring, const uint8_t *data, size_t size);
+
+// Writes all of data or, if it does not fit, drops all of it.
+bool ring_write_all(struct ring *ring, const uint8_t *data, size_t size);
+
+// Points data at the free space following the head and returns how much of it
+// is contiguous; ring_publish then hands over the bytes filled in.
+size_t ring_reserve_contiguous(struct ring *ring, uint8_t **data);
+
+void ring_publish(struct ring *ring, size_t size);
+
+// Consumer side.
+
+size_t ring_available(const struct ring *ring);
+
+bool ring_pop(struct ring *ring, uint8_t *byte);
+
+// Points data at the oldest unread bytes and returns how many follow
+// contiguously; ring_commit then releases the bytes dealt with.
+size_t ring_peek_contiguous(const struct ring *ring, const uint8_t **data);
+
+void ring_commit(struct ring *ring, size_t size);
+
+size_t ring_dropped(const struct ring *ring);
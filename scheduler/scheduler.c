@@ -0,0 +1,68 @@
+#include "scheduler.h"
+
+void scheduler_init(struct scheduler *scheduler, struct scheduler_task *tasks,
+                    size_t count, uint64_t (*now_us)(),
+                    uint32_t yield_interval_us) {
+  scheduler->tasks = tasks;
+  scheduler->count = count;
+  scheduler->now_us = now_us;
+  scheduler->yield_interval_us = yield_interval_us;
+
+  uint64_t now = now_us();
+  scheduler->next_yield_us = now + yield_interval_us;
+
+  for (size_t i = 0; i < count; i++) {
+    tasks[i].due_us = now;
+    tasks[i].running = false;
+    tasks[i].max_wait_us = 0;
+  }
+}
+
+static bool run_task(struct scheduler *scheduler, struct scheduler_task *task,
+                     uint64_t now) {
+  if (task->due_us > now)
+    return false;
+
+  if (now - task->due_us > task->max_wait_us)
+    task->max_wait_us = now - task->due_us;
+
+  task->running = true;
+  bool more = task->run(now + task->budget_us);
+  task->running = false;
+
+  now = scheduler->now_us();
+  task->due_us = more ? now : now + task->period_us;
+
+  return more;
+}
+
+bool scheduler_run(struct scheduler *scheduler) {
+  bool more = false;
+
+  for (size_t i = 0; i < scheduler->count; i++)
+    more |= run_task(scheduler, &scheduler->tasks[i], scheduler->now_us());
+
+  scheduler->next_yield_us = scheduler->now_us() + scheduler->yield_interval_us;
+
+  return more;
+}
+
+void scheduler_yield(struct scheduler *scheduler) {
+  uint64_t now = scheduler->now_us();
+
+  if (now < scheduler->next_yield_us)
+    return;
+
+  // Pushed out first, so that a task that ends up back here does not run
+  // again.
+  scheduler->next_yield_us = UINT64_MAX;
+
+  for (size_t i = 0; i < scheduler->count; i++) {
+    struct scheduler_task *task = &scheduler->tasks[i];
+
+    if (task->preempts && !task->running)
+      run_task(scheduler, task, now);
+  }
+
+  scheduler->next_yield_us = scheduler->now_us() + scheduler->yield_interval_us;
+}
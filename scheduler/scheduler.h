@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// A task runs to completion: it does what it can before its deadline and
+// returns whether it has work left over, which keeps it due.
+struct scheduler_task {
+  const char *name;
+  bool (*run)(uint64_t deadline_us);
+  // How long one run may take.
+  uint32_t budget_us;
+  // How long to leave it once it has run out of work; 0 polls it every pass.
+  uint32_t period_us;
+  // Whether scheduler_yield may run it from inside another task.
+  bool preempts;
+
+  uint64_t due_us;
+  bool running;
+  // Longest a run started after the task fell due.
+  uint32_t max_wait_us;
+};
+
+struct scheduler {
+  // Highest priority first.
+  struct scheduler_task *tasks;
+  size_t count;
+  uint64_t (*now_us)();
+  // scheduler_yield does nothing until this long after it last ran tasks.
+  uint32_t yield_interval_us;
+
+  uint64_t next_yield_us;
+};
+
+void scheduler_init(struct scheduler *scheduler, struct scheduler_task *tasks,
+                    size_t count, uint64_t (*now_us)(),
+                    uint32_t yield_interval_us);
+
+// Runs every due task once, highest priority first. Returns whether any of
+// them has work left over.
+bool scheduler_run(struct scheduler *scheduler);
+
+// For long operations to call as often as they like: at most once per yield
+// interval, runs the due tasks that preempt, unless one is already running.
+void scheduler_yield(struct scheduler *scheduler);
@@ -0,0 +1,43 @@
+#include "serial_rx.h"
+
+void serial_rx_init(struct serial_rx *rx, const uint8_t *buffer, size_t size,
+                    const struct serial_rx_transport *transport) {
+  rx->buffer = buffer;
+  rx->size = size;
+  rx->transport = transport;
+  rx->tail = transport->write_offset() & (size - 1);
+  atomic_init(&rx->head, rx->tail);
+}
+
+void serial_rx_publish(struct serial_rx *rx) {
+  // The offset is read afresh each time rather than accumulated, so a publish
+  // from the interrupt handler racing one from the consumer can at worst leave
+  // a slightly older, still correct offset behind.
+  size_t head = rx->transport->write_offset() & (rx->size - 1);
+
+  atomic_store_explicit(&rx->head, head, memory_order_release);
+}
+
+size_t serial_rx_available(const struct serial_rx *rx) {
+  size_t head = atomic_load_explicit(&rx->head, memory_order_acquire);
+
+  return (head - rx->tail) & (rx->size - 1);
+}
+
+size_t serial_rx_peek(const struct serial_rx *rx, const uint8_t **data,
+                      size_t max_size) {
+  size_t size = serial_rx_available(rx);
+
+  if (size > rx->size - rx->tail)
+    size = rx->size - rx->tail;
+  if (size > max_size)
+    size = max_size;
+
+  *data = rx->buffer + rx->tail;
+
+  return size;
+}
+
+void serial_rx_consume(struct serial_rx *rx, size_t size) {
+  rx->tail = (rx->tail + size) & (rx->size - 1);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Where received bytes come from. The transport writes into the ring on its
+// own, wrapping round at the end (a DMA channel with address wrap on the
+// device, a test producer on the host), and only has to say where it will
+// write next. It cannot be held back, so a consumer that falls a whole ring
+// behind loses data.
+struct serial_rx_transport {
+  size_t (*write_offset)();
+};
+
+struct serial_rx {
+  const uint8_t *buffer;
+  // A power of two.
+  size_t size;
+  const struct serial_rx_transport *transport;
+
+  // Write offset last published, and the consumer's read offset.
+  atomic_size_t head;
+  size_t tail;
+};
+
+void serial_rx_init(struct serial_rx *rx, const uint8_t *buffer, size_t size,
+                    const struct serial_rx_transport *transport);
+
+// Makes what the transport has written so far visible to the consumer. Safe to
+// call from an interrupt handler and from the consumer at the same time.
+void serial_rx_publish(struct serial_rx *rx);
+
+// Number of published bytes not consumed yet.
+size_t serial_rx_available(const struct serial_rx *rx);
+
+// Points data at the oldest unconsumed bytes and returns how many follow
+// contiguously, at most max_size.
+size_t serial_rx_peek(const struct serial_rx *rx, const uint8_t **data,
+                      size_t max_size);
+
+void serial_rx_consume(struct serial_rx *rx, size_t size);
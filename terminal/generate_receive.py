@@ -0,0 +1,145 @@
+#!/usr/bin/env python
+
+import sys
+import argparse
+
+BYTES = 256
+
+def parse_byte(token):
+    if len(token) == 3 and token[0] == token[2] == "'":
+        return ord(token[1])
+
+    return int(token, 16)
+
+def parse_bytes(token):
+    # Quoted dashes are bytes of their own, so ranges split on the dash
+    # between the two ends.
+    if len(token) > 3 and token[0] == "'" and token[3:4] == '-':
+        return range(parse_byte(token[:3]), parse_byte(token[4:]) + 1)
+
+    if "'" not in token and '-' in token:
+        first, last = token.split('-')
+        return range(parse_byte(first), parse_byte(last) + 1)
+
+    return [parse_byte(token)]
+
+def parse_states(path):
+    groups = {}
+    states = []
+    entries = None
+
+    with open(path) as f:
+        for number, line in enumerate(f, 1):
+            fields = line.split()
+            if not fields or fields[0].startswith('#'):
+                continue
+
+            if fields[0] == 'group':
+                entries = groups[fields[1]] = []
+            elif fields[0] == 'state':
+                entries = []
+                states.append({
+                    'name': fields[1],
+                    'title': ' '.join(fields[2:]).strip('"'),
+                    'entries': entries,
+                    'default': None,
+                })
+            elif fields[0] == 'use':
+                entries += groups[fields[1]]
+            elif fields[0] == 'default':
+                states[-1]['default'] = fields[1]
+            elif len(fields) == 2 and entries is not None:
+                entries += [(byte, fields[1]) for byte in parse_bytes(fields[0])]
+            else:
+                sys.exit(f'{path}:{number}: cannot parse "{line.strip()}"')
+
+    for state in states:
+        if state['default'] is None:
+            sys.exit(f'{path}: state {state["name"]} has no default')
+
+    return states
+
+# Resolves every byte of every state to a handler, then gives bytes that all
+# states handle alike the same class, so each state only needs a handler per
+# class.
+def compile_states(states):
+    handlers = []
+    rows = []
+
+    for state in states:
+        row = [state['default']] * BYTES
+        for byte, handler in state['entries']:
+            row[byte] = handler
+
+        rows.append(row)
+
+        for handler in row + [state['default']]:
+            if handler not in handlers:
+                handlers.append(handler)
+
+    classes = []
+    byte_classes = []
+
+    for byte in range(BYTES):
+        column = tuple(row[byte] for row in rows)
+        if column not in classes:
+            classes.append(column)
+
+        byte_classes.append(classes.index(column))
+
+    if len(classes) > 255 or len(handlers) > 255:
+        sys.exit('too many classes or handlers for uint8_t indices')
+
+    for i, state in enumerate(states):
+        state['actions'] = [handlers.index(column[i]) for column in classes]
+        state['default_action'] = handlers.index(state['default'])
+
+    return handlers, byte_classes, len(classes)
+
+def format_ints_literal(i):
+    return '{{{data}}}'.format(data=', '.join(str(x) for x in i))
+
+def main(args):
+    states = parse_states(args['states'])
+    handlers, byte_classes, class_count = compile_states(states)
+
+    out = (
+        '// Generated by generate_receive.py from receive_states.txt.\n\n'
+        + ''.join(f'static void {handler}(struct terminal *terminal, '
+                  'character_t character);\n' for handler in handlers) +
+        '\n'
+        f'#define RECEIVE_CLASS_COUNT {class_count}\n\n'
+        'struct receive_table {\n'
+        '  uint8_t actions[RECEIVE_CLASS_COUNT];\n'
+        '  uint8_t default_action;\n'
+        '};\n\n'
+        f'static const uint8_t receive_classes[{BYTES}] = '
+        f'{format_ints_literal(byte_classes)};\n\n'
+        'static const receive_t receive_handlers[] = {\n'
+        + ''.join(f'    {handler},\n' for handler in handlers) +
+        '};\n\n'
+        + ''.join(
+            f'static const receive_table_t {state["name"]}_receive_table = {{\n'
+            f'    {format_ints_literal(state["actions"])},\n'
+            f'    {state["default_action"]},\n'
+            '};\n\n' for state in states) +
+        '#ifdef TERMINAL_HOST\n'
+        'static const struct {\n'
+        '  const receive_table_t *table;\n'
+        '  const char *name;\n'
+        '} receive_table_names[] = {\n'
+        + ''.join(f'    {{&{state["name"]}_receive_table, "{state["title"]}"}},\n'
+                  for state in states) +
+        '};\n'
+        '#endif\n'
+    )
+
+    with open(args['outfile'], 'w') as f:
+        f.write(out)
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description='Generate the receive parser tables from a state description')
+    parser.add_argument('--outfile', '-o', help='file to output', default='receive_tables.h')
+    parser.add_argument('states', help='the state description')
+    args = parser.parse_args()
+    main(vars(args))
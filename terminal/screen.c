@@ -3,8 +3,6 @@
 
 #include <string.h>
 
-#define REPLACEMENT_CODEPOINT 32 
-
 #define ROWS screen->format.rows
 #define COLS screen->format.cols
 
@@ -16,65 +14,196 @@
 #define SCREEN_WIDTH_BYTES 64
 
 #define X_MARGIN 16
-#define Y_MARGIN 39
 
-void setSixBitsAt(uint8_t *buffer, uint8_t sixBits, int row, int col, int line) {
-  if (row < 0 || col < 0) {
+// Text rows are centred vertically, so the margin depends on the format.
+#define Y_MARGIN ((SCREEN_HEIGHT_PIXELS - ROWS * CHAR_HEIGHT_LINES) / 2)
+
+#define ROW_BYTES (CHAR_HEIGHT_LINES * SCREEN_WIDTH_BYTES)
+
+static void setSixBitsAt(uint8_t *line, uint8_t sixBits, int col) {
+  if (col < 0) {
     return;
   }
   int x = X_MARGIN + col * CHAR_WIDTH_PIXELS;
-  int y = Y_MARGIN + row * CHAR_HEIGHT_LINES + line;
 
   sixBits &= 0b00111111;
 
   int xByte = x / 8;
   int xOffset = x % 8;
 
-  uint8_t current = buffer[y * SCREEN_WIDTH_BYTES + xByte];
-  buffer[y * SCREEN_WIDTH_BYTES + xByte] = (
+  uint8_t current = line[xByte];
+  line[xByte] = (
     ((sixBits << 2) >> xOffset) +
     (current & ~(0b11111100 >> xOffset))
   );
 
   if (xOffset > 2) {
-    current = buffer[y * SCREEN_WIDTH_BYTES + xByte + 1];
-    buffer[y * SCREEN_WIDTH_BYTES + xByte + 1] = (
+    current = line[xByte + 1];
+    line[xByte + 1] = (
       (sixBits << (10 - xOffset)) +
       (current & (0b11111111 >> (xOffset - 2)))
     );
   }
 }
 
-uint8_t getSixBitsAt(uint8_t *buffer, int row, int col, int line) {
+static uint8_t getSixBitsAt(const uint8_t *line, int col) {
   int x = X_MARGIN + col * CHAR_WIDTH_PIXELS;
-  int y = Y_MARGIN + row * CHAR_HEIGHT_LINES + line;
 
   int xByte = x / 8;
   int xOffset = x % 8;
 
-  uint8_t value = ((buffer[y * SCREEN_WIDTH_BYTES + xByte] << xOffset) & 0b11111100) >> 2;
+  uint8_t value = ((line[xByte] << xOffset) & 0b11111100) >> 2;
 
   if (xOffset > 2) {
-    uint8_t secondByte = buffer[y * SCREEN_WIDTH_BYTES + xByte + 1] >> (10 - xOffset);
+    uint8_t secondByte = line[xByte + 1] >> (10 - xOffset);
     value += secondByte;
   }
 
   return value;
 }
 
+// With a ring backend the text rows are stored rotated by row_offset and the
+// video output starts reading them at that row. Both are below ROWS, so the
+// wrap is a subtraction rather than a division on every glyph.
+static uint8_t *row_lines(struct screen *screen, size_t row) {
+  size_t stored_row = row + screen->row_offset;
+
+  if (stored_row >= ROWS) {
+    stored_row -= ROWS;
+  }
+
+  return screen->buffer + Y_MARGIN * SCREEN_WIDTH_BYTES +
+         stored_row * ROW_BYTES;
+}
+
+// Whether rows from_row to to_row are stored one after another.
+static bool rows_contiguous(struct screen *screen, size_t from_row,
+                            size_t to_row) {
+  return (from_row + screen->row_offset) % ROWS + (to_row - from_row) <= ROWS;
+}
+
+// Cells are 6 pixels wide on a 32-bit word grid, so the cell/word alignment
+// repeats every 16 cells (96 pixels, 3 words). For each of those phases the
+// table gives the first word the cell touches, the shifts that place the 6
+// glyph bits in it (and in the next word when the cell straddles two) and the
+// matching masks. Pixels are MSB first in byte order, so masks are stored
+// byte-swapped to apply directly to little-endian words of the buffer.
+#define BLIT_PHASES 16
+#define BLIT_PHASE_WORDS 3
+#define SCREEN_WIDTH_WORDS (SCREEN_WIDTH_BYTES / 4)
+
+
+#define BSWAP32(v)                                                             \
+  ((((v)&0xffu) << 24) | (((v)&0xff00u) << 8) | (((v) >> 8) & 0xff00u) |      \
+   ((v) >> 24))
+
+#define BLIT_X(phase) (X_MARGIN + (phase)*CHAR_WIDTH_PIXELS)
+#define BLIT_OFFSET(phase) (BLIT_X(phase) % 32)
+#define BLIT_SPILL(phase)                                                      \
+  (BLIT_OFFSET(phase) > 26 ? BLIT_OFFSET(phase) - 26 : 0)
+#define BLIT_SHIFT(phase)                                                      \
+  (BLIT_OFFSET(phase) > 26 ? 0 : 26 - BLIT_OFFSET(phase))
+
+#define BLIT_PHASE(phase)                                                      \
+  {                                                                            \
+    .word = BLIT_X(phase) / 32,                                                \
+    .shift = BLIT_SHIFT(phase),                                                \
+    .spill = BLIT_SPILL(phase),                                                \
+    .mask = BSWAP32((0x3fu << BLIT_SHIFT(phase)) >> BLIT_SPILL(phase)),        \
+    .spill_mask = BLIT_SPILL(phase)                                            \
+                      ? BSWAP32(0x3fu << (32 - BLIT_SPILL(phase)))             \
+                      : 0,                                                     \
+  }
+
+struct blit_phase {
+  uint8_t word;
+  uint8_t shift;
+  uint8_t spill;
+  uint32_t mask;
+  uint32_t spill_mask;
+};
+
+static const struct blit_phase blit_phases[BLIT_PHASES] = {
+    BLIT_PHASE(0),  BLIT_PHASE(1),  BLIT_PHASE(2),  BLIT_PHASE(3),
+    BLIT_PHASE(4),  BLIT_PHASE(5),  BLIT_PHASE(6),  BLIT_PHASE(7),
+    BLIT_PHASE(8),  BLIT_PHASE(9),  BLIT_PHASE(10), BLIT_PHASE(11),
+    BLIT_PHASE(12), BLIT_PHASE(13), BLIT_PHASE(14), BLIT_PHASE(15),
+};
+
+// Writes one 6-pixel column of lines (one byte per line, right aligned) to the
+// cell at col of the row starting at row_lines, which must be word aligned.
+static void blit_cell(uint8_t *row_lines, int col, const uint8_t *lines,
+                      size_t count) {
+  const struct blit_phase *phase = &blit_phases[col % BLIT_PHASES];
+
+  uint32_t *word = (uint32_t *)row_lines +
+                   (col / BLIT_PHASES) * BLIT_PHASE_WORDS + phase->word;
+
+  if (phase->spill) {
+    for (size_t i = 0; i < count; i++, word += SCREEN_WIDTH_WORDS) {
+      uint32_t bits = lines[i] & 0x3f;
+
+      word[0] = (word[0] & ~phase->mask) | __builtin_bswap32(bits >> phase->spill);
+      word[1] = (word[1] & ~phase->spill_mask) |
+                __builtin_bswap32(bits << (32 - phase->spill));
+    }
+  } else {
+    for (size_t i = 0; i < count; i++, word += SCREEN_WIDTH_WORDS) {
+      uint32_t bits = lines[i] & 0x3f;
+
+      word[0] = (word[0] & ~phase->mask) | __builtin_bswap32(bits << phase->shift);
+    }
+  }
+}
+
 void clear_line(struct screen *screen, color_t inactive, size_t row, size_t line, size_t from_col, size_t to_col) {
   uint8_t sixBits = inactive == 0xf ? 0xff : 0;
 
   uint32_t startPixel = X_MARGIN + from_col * CHAR_WIDTH_PIXELS;
   uint32_t endPixel = X_MARGIN + to_col * CHAR_WIDTH_PIXELS;
 
-  uint32_t offset = (Y_MARGIN + (row * CHAR_HEIGHT_LINES) + line) * SCREEN_WIDTH_BYTES;
-  uint16_t startByte = offset + (startPixel / 8 + ((startPixel % 8) ? 1 : 0));
-  uint16_t endByte = offset + (endPixel / 8);
+  uint8_t *buffer = row_lines(screen, row) + line * SCREEN_WIDTH_BYTES;
+  uint16_t startByte = startPixel / 8 + ((startPixel % 8) ? 1 : 0);
+  uint16_t endByte = endPixel / 8;
+
+  setSixBitsAt(buffer, sixBits, from_col);
+  memset(buffer + startByte, sixBits, endByte - startByte);
+  setSixBitsAt(buffer, sixBits, to_col - 1);
+}
+
+// The text area starts and ends on byte boundaries, so whole rows clear with
+// a memset per line.
+static void clear_row(struct screen *screen, size_t row, color_t inactive) {
+  uint8_t pixels = inactive == 0xf ? 0xff : 0;
+  size_t from_byte = X_MARGIN / 8;
+  size_t to_byte = (X_MARGIN + COLS * CHAR_WIDTH_PIXELS) / 8;
+
+  uint8_t *line = row_lines(screen, row);
 
-  setSixBitsAt(screen->buffer, sixBits, row, from_col, line);
-  memset(screen->buffer + startByte, sixBits, endByte - startByte);
-  setSixBitsAt(screen->buffer, sixBits, row, to_col - 1, line);
+  for (size_t j = 0; j < CHAR_HEIGHT_LINES; j++, line += SCREEN_WIDTH_BYTES) {
+    memset(line + from_byte, pixels, to_byte - from_byte);
+  }
+}
+
+void screen_wait_move(struct screen *screen) {
+  if (screen->move_to_row <= screen->move_from_row) {
+    return;
+  }
+
+  screen->move_backend->wait();
+
+  for (size_t i = screen->move_clear_from_row; i < screen->move_to_row; i++) {
+    clear_row(screen, i, screen->move_clear_inactive);
+  }
+
+  screen->move_from_row = screen->move_to_row = 0;
+}
+
+// Completes a background move before rows it covers are read or written.
+static void fence(struct screen *screen, size_t from_row, size_t to_row) {
+  if (from_row < screen->move_to_row && screen->move_from_row < to_row) {
+    screen_wait_move(screen);
+  }
 }
 
 void screen_clear_rows(struct screen *screen, size_t from_row, size_t to_row,
@@ -87,11 +216,12 @@ void screen_clear_rows(struct screen *screen, size_t from_row, size_t to_row,
     return;
   }
 
+  fence(screen, from_row, to_row);
+
   for (size_t i = from_row; i < to_row; i++) {
-    for (size_t j = 0; j < CHAR_HEIGHT_LINES; j++) {
-      clear_line(screen, inactive, i, j, 0, COLS);
-      yield();
-    }
+    clear_row(screen, i, inactive);
+
+    yield();
   }
 }
 
@@ -109,6 +239,8 @@ void screen_clear_cols(struct screen *screen, size_t row, size_t from_col,
     return;
   }
 
+  fence(screen, row, row + 1);
+
   for (size_t i = 0; i < CHAR_HEIGHT_LINES; i++) {
     clear_line(screen, inactive, row, i, from_col, to_col);
 
@@ -119,17 +251,20 @@ void screen_clear_cols(struct screen *screen, size_t row, size_t from_col,
 void copy_cols(struct screen *screen, size_t from_row, size_t from_col, size_t to_row, size_t to_col, size_t cols, void (*yield)()) {
   uint8_t tmp[SCREEN_WIDTH_BYTES];
 
+  fence(screen, from_row, from_row + 1);
+  fence(screen, to_row, to_row + 1);
+
   for (int j = 0; j < CHAR_HEIGHT_LINES; j++) {
-    int from_y = Y_MARGIN + from_row * CHAR_HEIGHT_LINES + j;
-    memcpy(tmp, screen->buffer + (from_y * SCREEN_WIDTH_BYTES), SCREEN_WIDTH_BYTES);
+    uint8_t *from_line = row_lines(screen, from_row) + j * SCREEN_WIDTH_BYTES;
+    memcpy(tmp, from_line, SCREEN_WIDTH_BYTES);
 
     for (int i = 0; i < cols; i++) {
-      uint8_t sixBits = getSixBitsAt(screen->buffer, from_row, from_col + i, j);
-      setSixBitsAt(tmp, sixBits, 0, to_col + i, -Y_MARGIN);
+      uint8_t sixBits = getSixBitsAt(from_line, from_col + i);
+      setSixBitsAt(tmp, sixBits, to_col + i);
     }
 
-    int to_y = Y_MARGIN + to_row * CHAR_HEIGHT_LINES + j;
-    memcpy(screen->buffer + (to_y * SCREEN_WIDTH_BYTES), tmp, SCREEN_WIDTH_BYTES);
+    uint8_t *to_line = row_lines(screen, to_row) + j * SCREEN_WIDTH_BYTES;
+    memcpy(to_line, tmp, SCREEN_WIDTH_BYTES);
 
     yield();
   }
@@ -184,27 +319,110 @@ void screen_scroll(struct screen *screen, enum scroll scroll, size_t from_row,
     return;
   }
 
-  if (scroll == SCROLL_DOWN) {
-    for (int i = to_row - from_row - 1; i >= 0; i--) {
-      if (from_row + rows + i >= ROWS) {
-        continue;
+  fence(screen, from_row, to_row);
+
+  if (screen->ring_backend && from_row == 0 && to_row == ROWS) {
+    // Scrolling the whole screen only rotates the ring of rows; the rows
+    // that come round to the other end are cleared.
+    if (scroll == SCROLL_UP) {
+      screen->row_offset = (screen->row_offset + rows) % ROWS;
+    } else {
+      screen->row_offset = (screen->row_offset + ROWS - rows) % ROWS;
+    }
+
+    screen->ring_backend->set_start(Y_MARGIN, ROWS * CHAR_HEIGHT_LINES,
+                                    screen->row_offset * CHAR_HEIGHT_LINES);
+
+    if (scroll == SCROLL_UP) {
+      screen_clear_rows(screen, to_row - rows, to_row, inactive, yield);
+    } else {
+      screen_clear_rows(screen, from_row, from_row + rows, inactive, yield);
+    }
+
+    return;
+  }
+
+  // Rows always span the full width, and screen_draw_border puts the same
+  // frame either side of the text area on every one of its lines, so a region
+  // stored in one piece moves as whole lines with a single memmove. A region that wraps round the ring
+  // moves a row at a time.
+  size_t moved_rows = to_row - from_row - rows;
+  bool contiguous = rows_contiguous(screen, from_row, to_row);
+
+  if (scroll == SCROLL_UP && screen->move_backend && contiguous) {
+    // Scrolling up copies towards lower addresses, which the backend can do
+    // while parsing carries on. The vacated rows are still being read, so
+    // they are cleared once the move has finished.
+    screen->move_backend->move(row_lines(screen, from_row),
+                               row_lines(screen, from_row + rows),
+                               moved_rows * ROW_BYTES);
+
+    screen->move_from_row = from_row;
+    screen->move_to_row = to_row;
+    screen->move_clear_from_row = to_row - rows;
+    screen->move_clear_inactive = inactive;
+  } else if (scroll == SCROLL_DOWN) {
+    if (contiguous) {
+      memmove(row_lines(screen, from_row + rows), row_lines(screen, from_row),
+              moved_rows * ROW_BYTES);
+    } else {
+      for (size_t i = moved_rows; i-- > 0;) {
+        memcpy(row_lines(screen, from_row + rows + i),
+               row_lines(screen, from_row + i), ROW_BYTES);
       }
-      copy_cols(screen, from_row + i, 0, from_row + rows + i, 0, COLS, yield);
     }
+    yield();
 
     screen_clear_rows(screen, from_row, from_row + rows, inactive, yield);
   } else if (scroll == SCROLL_UP) {
-    for (int i = 0; i < to_row - from_row; i++) {
-      if (from_row + i < rows) {
-        continue;
+    if (contiguous) {
+      memmove(row_lines(screen, from_row), row_lines(screen, from_row + rows),
+              moved_rows * ROW_BYTES);
+    } else {
+      for (size_t i = 0; i < moved_rows; i++) {
+        memcpy(row_lines(screen, from_row + i),
+               row_lines(screen, from_row + rows + i), ROW_BYTES);
       }
-      copy_cols(screen, from_row + i, 0, from_row - rows + i, 0, COLS, yield);
     }
+    yield();
 
     screen_clear_rows(screen, to_row - rows, to_row, inactive, yield);
   }
 }
 
+static const struct bitmap_font *select_font(struct screen *screen,
+                                             enum font font) {
+  if (font == FONT_BOLD) {
+    return screen->bold_bitmap_font;
+  } else {
+    return screen->normal_bitmap_font;
+  }
+}
+
+static uint8_t glyph_line(const struct bitmap_font *bitmap_font,
+                          const uint8_t *glyph, size_t char_line,
+                          bool underlined, bool crossedout, color_t active,
+                          color_t inactive) {
+  size_t underlined_line = CHAR_HEIGHT_LINES - 1;
+  size_t crossedout_line = CHAR_HEIGHT_LINES - 5;
+
+  uint8_t pixels = inactive == DEFAULT_ACTIVE_COLOR ? 0xff : 0;
+
+  if (char_line < bitmap_font->height) {
+    pixels = active == DEFAULT_ACTIVE_COLOR ? glyph[char_line] : ~glyph[char_line];
+  }
+
+  if (underlined && char_line == underlined_line) {
+    pixels ^= active == DEFAULT_ACTIVE_COLOR ? 0xff : 0;
+  }
+
+  if (crossedout && char_line == crossedout_line) {
+    pixels = active == DEFAULT_ACTIVE_COLOR ? 0xff : 0;
+  }
+
+  return pixels;
+}
+
 void screen_draw_codepoint(struct screen *screen, size_t row, size_t col,
                            codepoint_t codepoint, enum font font, bool italic,
                            bool underlined, bool crossedout, color_t active,
@@ -217,40 +435,132 @@ void screen_draw_codepoint(struct screen *screen, size_t row, size_t col,
     return;
   }
 
-  const struct bitmap_font *bitmap_font;
-  if (font == FONT_BOLD) {
-    bitmap_font = screen->bold_bitmap_font;
-  } else {
-    bitmap_font = screen->normal_bitmap_font;
+  fence(screen, row, row + 1);
+
+  const struct bitmap_font *bitmap_font = select_font(screen, font);
+  const uint8_t *glyph = find_glyph(bitmap_font, codepoint);
+
+  uint8_t lines[CHAR_HEIGHT_LINES];
+
+  for (size_t char_line = 0; char_line < CHAR_HEIGHT_LINES; char_line++) {
+    lines[char_line] = glyph_line(bitmap_font, glyph, char_line, underlined,
+                                  crossedout, active, inactive);
   }
 
-  const unsigned char *glyph = find_glyph(bitmap_font, codepoint);
+  blit_cell(row_lines(screen, row), col, lines, CHAR_HEIGHT_LINES);
+}
+
+// Mask of the pixels from x to the end of its word, and of the pixels of the
+// word up to (not including) x, in logical MSB-first order.
+#define HEAD_MASK(x) (0xffffffffu >> ((x) % 32))
+#define TAIL_MASK(x) ((x) % 32 ? ~(0xffffffffu >> ((x) % 32)) : 0xffffffffu)
 
-  if (!glyph) {
-    glyph = find_glyph(bitmap_font, REPLACEMENT_CODEPOINT);
+void screen_draw_run(struct screen *screen, size_t row, size_t col,
+                     const codepoint_t *codepoints, size_t count,
+                     enum font font, bool italic, bool underlined,
+                     bool crossedout, color_t active, color_t inactive) {
+  if (row >= ROWS) {
+    return;
   }
 
-  size_t underlined_line = CHAR_HEIGHT_LINES - 1;
-  size_t crossedout_line = CHAR_HEIGHT_LINES - 5;
+  if (col >= COLS) {
+    return;
+  }
+
+  if (count > COLS - col) {
+    count = COLS - col;
+  }
+
+  if (!count) {
+    return;
+  }
+
+  fence(screen, row, row + 1);
+
+  const struct bitmap_font *bitmap_font = select_font(screen, font);
+
+  size_t from_x = X_MARGIN + col * CHAR_WIDTH_PIXELS;
+  size_t to_x = from_x + count * CHAR_WIDTH_PIXELS;
+  size_t from_word = from_x / 32;
+  size_t to_word = (to_x - 1) / 32;
+  size_t words = to_word - from_word + 1;
+
+  uint32_t head_mask = HEAD_MASK(from_x);
+  uint32_t tail_mask = TAIL_MASK(to_x);
+  if (from_word == to_word) {
+    head_mask &= tail_mask;
+  }
+
+  // The run is assembled in a line buffer, one row of words per scanline in
+  // logical bit order, and then stored a word at a time: words fully covered
+  // by the run are written without reading them back, only the two edge words
+  // need a read-modify-write. Building the buffer is cheap next to rendering
+  // the glyph lines, which costs the same as drawing cell by cell, so the
+  // saving comes from the stores and per-cell setup and grows with the run.
+  uint32_t lines[CHAR_HEIGHT_LINES][SCREEN_WIDTH_WORDS];
 
   for (size_t char_line = 0; char_line < CHAR_HEIGHT_LINES; char_line++) {
-    uint8_t pixels = inactive == DEFAULT_ACTIVE_COLOR ? 0xff : 0;
+    memset(lines[char_line] + from_word, 0, words * sizeof(uint32_t));
+  }
 
-    if (glyph) {
-      if (char_line < bitmap_font->height) {
-        pixels = active == DEFAULT_ACTIVE_COLOR ? glyph[char_line] : ~glyph[char_line];
+  for (size_t i = 0; i < count; i++) {
+    const uint8_t *glyph = find_glyph(bitmap_font, codepoints[i]);
+    const struct blit_phase *phase = &blit_phases[(col + i) % BLIT_PHASES];
+    size_t word =
+        ((col + i) / BLIT_PHASES) * BLIT_PHASE_WORDS + phase->word;
+
+    for (size_t char_line = 0; char_line < CHAR_HEIGHT_LINES; char_line++) {
+      uint32_t bits = glyph_line(bitmap_font, glyph, char_line, underlined,
+                                 crossedout, active, inactive) &
+                      0x3f;
+
+      if (phase->spill) {
+        lines[char_line][word] |= bits >> phase->spill;
+        lines[char_line][word + 1] |= bits << (32 - phase->spill);
+      } else {
+        lines[char_line][word] |= bits << phase->shift;
       }
+    }
+  }
 
-      if (underlined && char_line == underlined_line) {
-        pixels ^= active == DEFAULT_ACTIVE_COLOR ? 0xff : 0;
-      }
+  uint32_t *buffer = (uint32_t *)row_lines(screen, row);
 
-      if (crossedout && char_line == crossedout_line) {
-        pixels = active == DEFAULT_ACTIVE_COLOR ? 0xff : 0;
-      }
+  for (size_t char_line = 0; char_line < CHAR_HEIGHT_LINES;
+       char_line++, buffer += SCREEN_WIDTH_WORDS) {
+    const uint32_t *line = lines[char_line];
+
+    buffer[from_word] = (buffer[from_word] & ~__builtin_bswap32(head_mask)) |
+                        __builtin_bswap32(line[from_word]);
+
+    for (size_t i = from_word + 1; i < to_word; i++) {
+      buffer[i] = __builtin_bswap32(line[i]);
+    }
+
+    if (to_word != from_word) {
+      buffer[to_word] = (buffer[to_word] & ~__builtin_bswap32(tail_mask)) |
+                        __builtin_bswap32(line[to_word]);
     }
+  }
+}
 
-    setSixBitsAt(screen->buffer, pixels, row, col, char_line);
+// The border sits two lines clear of the text area: side bars on every line
+// in between, so that they are the same on every line the text rows move
+// through, and a rule above and below.
+void screen_draw_border(struct screen *screen) {
+  size_t top = Y_MARGIN - 3;
+  size_t bottom = Y_MARGIN + ROWS * CHAR_HEIGHT_LINES + 2;
+
+  for (size_t y = top; y <= bottom; y++) {
+    uint8_t *line = screen->buffer + y * SCREEN_WIDTH_BYTES;
+
+    if (y == top || y == bottom) {
+      line[1] = 0b00000111;
+      memset(line + 2, 0xff, SCREEN_WIDTH_BYTES - 4);
+      line[SCREEN_WIDTH_BYTES - 2] = 0b11100000;
+    } else {
+      line[1] = 0b00000100;
+      line[SCREEN_WIDTH_BYTES - 2] = 0b00100000;
+    }
   }
 }
 
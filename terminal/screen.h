@@ -15,6 +15,24 @@ typedef uint16_t codepoint_t;
 #define DEFAULT_ACTIVE_COLOR 0xf
 #define DEFAULT_INACTIVE_COLOR 0
 
+// Optional engine that moves framebuffer blocks in the background, such as a
+// DMA channel. move may return before the copy is done and is only asked to
+// copy towards lower addresses; wait blocks until the last move has finished.
+struct screen_move_backend
+{
+  void (*move)(uint8_t *to, const uint8_t *from, size_t size);
+  void (*wait)();
+};
+
+// Optional video output that can start the text area at any of its lines, so
+// that scrolling the whole screen becomes a rotation of the rows. The text
+// area is lines first_line to first_line + lines of the buffer, shown from
+// start_line onwards and wrapping round; takes effect from the next frame.
+struct screen_ring_backend
+{
+  void (*set_start)(size_t first_line, size_t lines, size_t start_line);
+};
+
 struct screen
 {
   const struct format format;
@@ -23,6 +41,18 @@ struct screen
   const struct bitmap_font *normal_bitmap_font;
   const struct bitmap_font *bold_bitmap_font;
   uint8_t *buffer;
+
+  const struct screen_ring_backend *ring_backend;
+  // Row of the buffer holding the top text row.
+  size_t row_offset;
+
+  const struct screen_move_backend *move_backend;
+  // Rows covered by a move still in flight, and the rows to clear once it has
+  // finished.
+  size_t move_from_row;
+  size_t move_to_row;
+  size_t move_clear_from_row;
+  color_t move_clear_inactive;
 };
 
 void screen_clear_rows(struct screen *screen, size_t from_row, size_t to_row, color_t inactive, void (*yield)());
@@ -40,6 +70,13 @@ void screen_shift_left(struct screen *screen, size_t row, size_t col, size_t col
 void screen_draw_codepoint(struct screen *screen, size_t row, size_t col, codepoint_t codepoint, enum font font,
                            bool italic, bool underlined, bool crossedout, color_t active, color_t inactive);
 
+void screen_draw_run(struct screen *screen, size_t row, size_t col, const codepoint_t *codepoints, size_t count,
+                     enum font font, bool italic, bool underlined, bool crossedout, color_t active, color_t inactive);
+
+void screen_wait_move(struct screen *screen);
+
+void screen_draw_border(struct screen *screen);
+
 void screen_test_fonts(struct screen *screen, enum font font);
 
 #endif
@@ -0,0 +1,237 @@
+#include "screen_queue.h"
+
+#include <string.h>
+
+#if SCREEN_QUEUE_SIZE & (SCREEN_QUEUE_SIZE - 1)
+#error "SCREEN_QUEUE_SIZE must be a power of two"
+#endif
+
+// The consumer owns the framebuffer, so there is nothing for it to service
+// between rows.
+static void no_yield() {}
+
+void screen_queue_init(struct screen_queue *queue, void (*wait)(),
+                       void (*notify)()) {
+  atomic_init(&queue->head, 0);
+  atomic_init(&queue->tail, 0);
+  queue->wait = wait;
+  queue->notify = notify;
+}
+
+static struct screen_command *reserve(struct screen_queue *queue,
+                                      enum screen_command_type type,
+                                      struct screen *screen) {
+  // wait may service the keyboard, which can push commands of its own, so
+  // the head is only read once there is room.
+  while (atomic_load_explicit(&queue->head, memory_order_relaxed) -
+             atomic_load_explicit(&queue->tail, memory_order_acquire) ==
+         SCREEN_QUEUE_SIZE) {
+    queue->wait();
+  }
+
+  size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+  struct screen_command *command =
+      &queue->commands[head % SCREEN_QUEUE_SIZE];
+  command->type = type;
+  command->screen = screen;
+
+  return command;
+}
+
+static void push(struct screen_queue *queue) {
+  size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+
+  atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+  queue->notify();
+}
+
+void screen_queue_draw_codepoint(struct screen_queue *queue,
+                                 struct screen *screen, size_t row, size_t col,
+                                 codepoint_t codepoint, enum font font,
+                                 bool italic, bool underlined, bool crossedout,
+                                 color_t active, color_t inactive) {
+  struct screen_command *command =
+      reserve(queue, SCREEN_COMMAND_DRAW_CODEPOINT, screen);
+
+  command->row = row;
+  command->col = col;
+  command->codepoints[0] = codepoint;
+  command->font = font;
+  command->italic = italic;
+  command->underlined = underlined;
+  command->crossedout = crossedout;
+  command->active = active;
+  command->inactive = inactive;
+
+  push(queue);
+}
+
+void screen_queue_draw_run(struct screen_queue *queue, struct screen *screen,
+                           size_t row, size_t col,
+                           const codepoint_t *codepoints, size_t count,
+                           enum font font, bool italic, bool underlined,
+                           bool crossedout, color_t active, color_t inactive) {
+  if (count > TERMINAL_MAX_COLS)
+    count = TERMINAL_MAX_COLS;
+
+  struct screen_command *command =
+      reserve(queue, SCREEN_COMMAND_DRAW_RUN, screen);
+
+  command->row = row;
+  command->col = col;
+  command->count = count;
+  memcpy(command->codepoints, codepoints, count * sizeof(codepoint_t));
+  command->font = font;
+  command->italic = italic;
+  command->underlined = underlined;
+  command->crossedout = crossedout;
+  command->active = active;
+  command->inactive = inactive;
+
+  push(queue);
+}
+
+void screen_queue_clear_rows(struct screen_queue *queue, struct screen *screen,
+                             size_t from_row, size_t to_row,
+                             color_t inactive) {
+  struct screen_command *command =
+      reserve(queue, SCREEN_COMMAND_CLEAR_ROWS, screen);
+
+  command->from = from_row;
+  command->to = to_row;
+  command->inactive = inactive;
+
+  push(queue);
+}
+
+void screen_queue_clear_cols(struct screen_queue *queue, struct screen *screen,
+                             size_t row, size_t from_col, size_t to_col,
+                             color_t inactive) {
+  struct screen_command *command =
+      reserve(queue, SCREEN_COMMAND_CLEAR_COLS, screen);
+
+  command->row = row;
+  command->from = from_col;
+  command->to = to_col;
+  command->inactive = inactive;
+
+  push(queue);
+}
+
+void screen_queue_scroll(struct screen_queue *queue, struct screen *screen,
+                         enum scroll scroll, size_t from_row, size_t to_row,
+                         size_t rows, color_t inactive) {
+  struct screen_command *command =
+      reserve(queue, SCREEN_COMMAND_SCROLL, screen);
+
+  command->scroll = scroll;
+  command->from = from_row;
+  command->to = to_row;
+  command->count = rows;
+  command->inactive = inactive;
+
+  push(queue);
+}
+
+void screen_queue_shift_right(struct screen_queue *queue,
+                              struct screen *screen, size_t row, size_t col,
+                              size_t cols, color_t inactive) {
+  struct screen_command *command =
+      reserve(queue, SCREEN_COMMAND_SHIFT_RIGHT, screen);
+
+  command->row = row;
+  command->col = col;
+  command->count = cols;
+  command->inactive = inactive;
+
+  push(queue);
+}
+
+void screen_queue_shift_left(struct screen_queue *queue, struct screen *screen,
+                             size_t row, size_t col, size_t cols,
+                             color_t inactive) {
+  struct screen_command *command =
+      reserve(queue, SCREEN_COMMAND_SHIFT_LEFT, screen);
+
+  command->row = row;
+  command->col = col;
+  command->count = cols;
+  command->inactive = inactive;
+
+  push(queue);
+}
+
+void screen_queue_test_fonts(struct screen_queue *queue, struct screen *screen,
+                             enum font font) {
+  struct screen_command *command =
+      reserve(queue, SCREEN_COMMAND_TEST_FONTS, screen);
+
+  command->font = font;
+
+  push(queue);
+}
+
+void screen_queue_sync(struct screen_queue *queue) {
+  size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+
+  while (atomic_load_explicit(&queue->tail, memory_order_acquire) != head) {
+    queue->wait();
+  }
+}
+
+static void execute(const struct screen_command *command) {
+  struct screen *screen = command->screen;
+
+  switch (command->type) {
+  case SCREEN_COMMAND_DRAW_CODEPOINT:
+    screen_draw_codepoint(screen, command->row, command->col,
+                          command->codepoints[0], command->font,
+                          command->italic, command->underlined,
+                          command->crossedout, command->active,
+                          command->inactive);
+    break;
+  case SCREEN_COMMAND_DRAW_RUN:
+    screen_draw_run(screen, command->row, command->col, command->codepoints,
+                    command->count, command->font, command->italic,
+                    command->underlined, command->crossedout, command->active,
+                    command->inactive);
+    break;
+  case SCREEN_COMMAND_CLEAR_ROWS:
+    screen_clear_rows(screen, command->from, command->to, command->inactive,
+                      no_yield);
+    break;
+  case SCREEN_COMMAND_CLEAR_COLS:
+    screen_clear_cols(screen, command->row, command->from, command->to,
+                      command->inactive, no_yield);
+    break;
+  case SCREEN_COMMAND_SCROLL:
+    screen_scroll(screen, command->scroll, command->from, command->to,
+                  command->count, command->inactive, no_yield);
+    break;
+  case SCREEN_COMMAND_SHIFT_RIGHT:
+    screen_shift_right(screen, command->row, command->col, command->count,
+                       command->inactive, no_yield);
+    break;
+  case SCREEN_COMMAND_SHIFT_LEFT:
+    screen_shift_left(screen, command->row, command->col, command->count,
+                      command->inactive, no_yield);
+    break;
+  case SCREEN_COMMAND_TEST_FONTS:
+    screen_test_fonts(screen, command->font);
+    break;
+  }
+}
+
+bool screen_queue_execute(struct screen_queue *queue) {
+  size_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+
+  if (atomic_load_explicit(&queue->head, memory_order_acquire) == tail)
+    return false;
+
+  execute(&queue->commands[tail % SCREEN_QUEUE_SIZE]);
+
+  // Only now can the producer reuse the slot, and screen_queue_sync return.
+  atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+
+  return true;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stdatomic.h>
+
+#include "screen.h"
+
+// Number of commands the queue holds; a power of two.
+#ifndef SCREEN_QUEUE_SIZE
+#define SCREEN_QUEUE_SIZE 32
+#endif
+
+enum screen_command_type {
+  SCREEN_COMMAND_DRAW_CODEPOINT,
+  SCREEN_COMMAND_DRAW_RUN,
+  SCREEN_COMMAND_CLEAR_ROWS,
+  SCREEN_COMMAND_CLEAR_COLS,
+  SCREEN_COMMAND_SCROLL,
+  SCREEN_COMMAND_SHIFT_RIGHT,
+  SCREEN_COMMAND_SHIFT_LEFT,
+  SCREEN_COMMAND_TEST_FONTS,
+};
+
+struct screen_command {
+  enum screen_command_type type;
+  struct screen *screen;
+
+  enum scroll scroll;
+  enum font font;
+  bool italic;
+  bool underlined;
+  bool crossedout;
+  color_t active;
+  color_t inactive;
+
+  uint8_t row;
+  uint8_t col;
+  uint8_t from;
+  uint8_t to;
+  uint8_t count;
+
+  codepoint_t codepoints[TERMINAL_MAX_COLS];
+};
+
+// Single producer, single consumer ring of screen operations, so that one
+// core can parse while the other rasterises. Commands run in order, so
+// operations that read pixels (scrolls and shifts) see every earlier write;
+// the producer only needs screen_queue_sync before touching the framebuffer
+// itself.
+struct screen_queue {
+  struct screen_command commands[SCREEN_QUEUE_SIZE];
+  atomic_size_t head;
+  atomic_size_t tail;
+
+  // Called by the producer while the queue is full or it waits for the
+  // consumer, and after each push to wake the consumer up.
+  void (*wait)();
+  void (*notify)();
+};
+
+void screen_queue_init(struct screen_queue *queue, void (*wait)(),
+                       void (*notify)());
+
+void screen_queue_draw_codepoint(struct screen_queue *queue,
+                                 struct screen *screen, size_t row, size_t col,
+                                 codepoint_t codepoint, enum font font,
+                                 bool italic, bool underlined, bool crossedout,
+                                 color_t active, color_t inactive);
+
+void screen_queue_draw_run(struct screen_queue *queue, struct screen *screen,
+                           size_t row, size_t col,
+                           const codepoint_t *codepoints, size_t count,
+                           enum font font, bool italic, bool underlined,
+                           bool crossedout, color_t active, color_t inactive);
+
+void screen_queue_clear_rows(struct screen_queue *queue, struct screen *screen,
+                             size_t from_row, size_t to_row, color_t inactive);
+
+void screen_queue_clear_cols(struct screen_queue *queue, struct screen *screen,
+                             size_t row, size_t from_col, size_t to_col,
+                             color_t inactive);
+
+void screen_queue_scroll(struct screen_queue *queue, struct screen *screen,
+                         enum scroll scroll, size_t from_row, size_t to_row,
+                         size_t rows, color_t inactive);
+
+void screen_queue_shift_right(struct screen_queue *queue,
+                              struct screen *screen, size_t row, size_t col,
+                              size_t cols, color_t inactive);
+
+void screen_queue_shift_left(struct screen_queue *queue, struct screen *screen,
+                             size_t row, size_t col, size_t cols,
+                             color_t inactive);
+
+void screen_queue_test_fonts(struct screen_queue *queue, struct screen *screen,
+                             enum font font);
+
+// Waits until the consumer has carried out every queued command.
+void screen_queue_sync(struct screen_queue *queue);
+
+// Consumer side: carries out the oldest command, if any. Returns whether
+// there was one.
+bool screen_queue_execute(struct screen_queue *queue);
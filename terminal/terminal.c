@@ -16,10 +16,15 @@
 #endif
 #define PRODUCT_HELP "\r\nPress CTRL+ALT+DEL to enter SETUP\r\n"
 
+// Until terminal_uart_set_receive_buffer_size says otherwise.
+#define DEFAULT_RECEIVE_BUFFER_SIZE 8192
+
 void terminal_timer_tick(struct terminal *terminal) {
   terminal_keyboard_update_repeat_counter(terminal);
   terminal_screen_update_cursor_counter(terminal);
   terminal_screen_update_blink_counter(terminal);
+  terminal_screen_update_synchronized_counter(terminal);
+  terminal->flow_ticks++;
 }
 
 void terminal_init(struct terminal *terminal,
@@ -29,8 +34,7 @@ void terminal_init(struct terminal *terminal,
                    struct visual_cell *alt_cells,
 #endif
                    uint8_t *tab_stops, size_t tab_stops_size,
-                   const struct terminal_config *config,
-                   character_t *transmit_buffer, size_t transmit_buffer_size) {
+                   const struct terminal_config *config) {
   terminal->callbacks = callbacks;
   terminal->default_cells = default_cells;
 #ifdef TERMINAL_ALT_CELLS
@@ -52,9 +56,6 @@ void terminal_init(struct terminal *terminal,
 #ifndef TERMINAL_8BIT_COLOR
   terminal->monochrome_transform = config->monochrome_transform;
 #endif
-  terminal->transmit_buffer = transmit_buffer;
-  terminal->transmit_buffer_size = transmit_buffer_size;
-  terminal->transmit_buffer_head = 0;
 
   terminal->charset = config->charset;
   terminal->keyboard_compatibility = config->keyboard_compatibility;
@@ -78,6 +79,9 @@ void terminal_init(struct terminal *terminal,
   terminal->backspace_mode = config->backspace_mode;
 
   terminal->flow_control = config->flow_control;
+  terminal->baud_rate = terminal_config_get_baud_rate(config);
+  terminal->receive_buffer_size = DEFAULT_RECEIVE_BUFFER_SIZE;
+  terminal->flow_ticks = 0;
 
   terminal->lock_state.caps = 0;
   terminal->lock_state.scroll = 0;
@@ -44,11 +44,23 @@ enum screen_test {
 
 struct terminal_callbacks {
   void (*keyboard_set_leds)(struct lock_state state);
-  void (*uart_transmit)(character_t *characters, size_t size, size_t head);
+  // Queues characters to send as one span, waiting briefly for room if the
+  // transmitter is busy. Returns false, having queued nothing, if they still
+  // do not fit; the caller may try again later.
+  bool (*uart_transmit)(const character_t *characters, size_t size);
+  // Sends XON or XOFF ahead of anything queued by uart_transmit. Returns false
+  // if it cannot go out right now. Optional: uart_transmit is used without it.
+  bool (*uart_transmit_flow)(character_t character);
+  // Asserts or deasserts RTS in RTS/CTS flow control.
+  void (*uart_set_rts)(bool ready);
   void (*screen_draw_codepoint)(struct format format, size_t row, size_t col,
                                 codepoint_t codepoint, enum font font,
                                 bool italic, bool underlined, bool crossedout,
                                 color_t active, color_t inactive);
+  void (*screen_draw_run)(struct format format, size_t row, size_t col,
+                          const codepoint_t *codepoints, size_t count,
+                          enum font font, bool italic, bool underlined,
+                          bool crossedout, color_t active, color_t inactive);
   void (*screen_clear_rows)(struct format format, size_t from_row,
                             size_t to_row, color_t inactive);
   void (*screen_clear_cols)(struct format format, size_t row, size_t from_col,
@@ -70,13 +82,19 @@ struct terminal_callbacks {
 struct terminal;
 
 typedef void (*receive_t)(struct terminal *, character_t);
-typedef receive_t receive_table_t[CHARACTER_DECODER_TABLE_LENGTH];
+// A receive parser state, generated from terminal/receive_states.txt.
+typedef struct receive_table receive_table_t;
 
 typedef codepoint_t
     codepoint_transformation_table_t[CHARACTER_DECODER_TABLE_LENGTH];
 
+#define TERMINAL_MAX_ROWS 30
+#define TERMINAL_MAX_COLS 80
+#define TERMINAL_DIRTY_ROW_SIZE (TERMINAL_MAX_COLS / 8)
+
 #define ESC_MAX_PARAMS_COUNT 16
-#define ESC_MAX_PARAM_LENGTH 16
+// Larger values saturate, so they still read as positive int16_t.
+#define ESC_MAX_PARAM_VALUE 32767
 
 struct visual_props {
   uint8_t font : 2;
@@ -128,6 +146,15 @@ struct control_data {
   size_t length;
 };
 
+// State of a UTF-8 sequence in progress: the codepoint bits so far, how many
+// continuation bytes are still due and the range the next one must be in.
+struct utf8_decoder {
+  uint32_t codepoint;
+  uint8_t remaining;
+  uint8_t lower;
+  uint8_t upper;
+};
+
 struct keys_entry;
 
 struct terminal {
@@ -158,7 +185,8 @@ struct terminal {
   enum c1_mode transmit_c1_mode;
 
   bool auto_wrap_mode;
-  bool scrolling_mode; // TODO
+  // DECSCLM: smooth scrolling when set, jump scrolling otherwise.
+  bool scrolling_mode;
   bool column_mode;    // TODO
   bool screen_mode;
   bool origin_mode;
@@ -191,29 +219,54 @@ struct terminal {
   bool blink_drawn;
 
   struct visual_cell *cells;
+  // Row of cells holding each screen row.
+  uint8_t row_map[TERMINAL_MAX_ROWS];
+
+  // In deferred render mode cell updates only set a bit here and
+  // terminal_screen_flush rasterises the marked cells later.
+  bool deferred_render;
+  uint8_t dirty_cells[TERMINAL_MAX_ROWS][TERMINAL_DIRTY_ROW_SIZE];
+  // Where terminal_screen_flush_slice carries on from.
+  int16_t flush_row;
+
+  // Jump scrolling adds up consecutive scrolls of the same region and hands
+  // them to screen_scroll in one go before anything else is drawn. It is
+  // used while DECSCLM is reset, and while the receive backlog is long.
+  bool jump_scroll_backlog;
+  enum scroll pending_scroll;
+  int16_t pending_scroll_from;
+  int16_t pending_scroll_to;
+  int16_t pending_scroll_rows;
+  color_t pending_scroll_inactive;
+
+  // Synchronized output (mode 2026) holds flushes back until it is reset or
+  // the counter, run down by terminal_timer_tick, runs out. Deferred
+  // rendering is turned on for the duration if it was off.
+  bool synchronized_update;
+  bool synchronized_deferred;
+  volatile uint16_t synchronized_counter;
 
   struct visual_cell *default_cells;
 #ifdef TERMINAL_ALT_CELLS
   struct visual_cell *alt_cells;
+  uint8_t default_row_map[TERMINAL_MAX_ROWS];
 #endif
 
   const receive_table_t *receive_table;
 
-  character_t esc_params[ESC_MAX_PARAMS_COUNT][ESC_MAX_PARAM_LENGTH];
+  // Accumulated as the digits arrive; only the first esc_params_count are
+  // valid. Bit n of esc_subparams is set when parameter n followed a colon.
+  uint16_t esc_params[ESC_MAX_PARAMS_COUNT];
+  uint16_t esc_subparams;
   size_t esc_params_count;
-  size_t esc_last_param_length;
+  bool esc_param_started;
+  bool esc_colon_pending;
 
   character_t vt52_move_cursor_row;
 
   codepoint_t prev_codepoint;
 
-  character_t *transmit_buffer;
-  size_t transmit_buffer_size;
-  size_t transmit_buffer_head;
-
-  size_t utf8_codepoint_length;
-  size_t utf8_buffer_length;
-  character_t utf8_buffer[4];
+  struct utf8_decoder utf8;
 
   struct control_data dcs;
   struct control_data osc;
@@ -223,7 +276,21 @@ struct terminal {
   enum gset gset_received;
   enum xon_off xon_off;
 
-  bool flow_control;
+  enum flow_control flow_control;
+  uint32_t baud_rate;
+  size_t receive_buffer_size;
+  // Receive buffer fill levels at which to stop and restart the host.
+  size_t xoff_limit;
+  size_t xon_limit;
+  // How fast the receive buffer is drained while there is a backlog, in bytes
+  // per second, and the measurement in progress. Ticks are counted by
+  // terminal_timer_tick.
+  uint32_t consume_rate;
+  volatile uint32_t flow_ticks;
+  uint32_t flow_window_start;
+  size_t flow_window_consumed;
+  bool flow_window_backlogged;
+  size_t flow_last_size;
 
 #ifdef DEBUG
 #define DEBUG_BUFFER_LENGTH 128
@@ -240,8 +307,7 @@ void terminal_init(struct terminal *terminal,
                    struct visual_cell *alt_cells,
 #endif
                    uint8_t *tab_stops, size_t tab_stops_size,
-                   const struct terminal_config *config,
-                   character_t *transmit_buffer, size_t transmit_buffer_size);
+                   const struct terminal_config *config);
 void terminal_keyboard_handle_key(struct terminal *terminal, bool shift,
                                   bool lalt, bool ralt, bool ctrl, uint8_t key);
 
@@ -249,18 +315,28 @@ void terminal_keyboard_update_leds(struct terminal *terminal);
 
 void terminal_uart_receive_character(struct terminal *terminal,
                                      character_t character);
+void terminal_uart_receive_buffer(struct terminal *terminal,
+                                  const character_t *characters, size_t size);
 void terminal_uart_receive_string(struct terminal *terminal,
                                   const char *string);
 
-void terminal_uart_transmit_character(struct terminal *terminal,
+bool terminal_uart_transmit_character(struct terminal *terminal,
                                       character_t character);
-void terminal_uart_transmit_string(struct terminal *terminal,
+bool terminal_uart_transmit_string(struct terminal *terminal,
                                    const char *string);
-void terminal_uart_transmit_printf(struct terminal *terminal,
-                                   const char *format, ...);
 
 void terminal_uart_flow_control(struct terminal *terminal, size_t receive_size);
+void terminal_uart_set_receive_buffer_size(struct terminal *terminal,
+                                           size_t size);
+
+#ifdef TERMINAL_HOST
+const char *terminal_uart_receive_state(struct terminal *terminal);
+#endif
 
 void terminal_timer_tick(struct terminal *terminal);
 void terminal_screen_update(struct terminal *terminal);
+void terminal_screen_set_deferred_render(struct terminal *terminal,
+                                         bool deferred);
+void terminal_screen_flush(struct terminal *terminal);
+bool terminal_screen_flush_slice(struct terminal *terminal, size_t budget);
 void terminal_keyboard_repeat_key(struct terminal *terminal);
@@ -11,6 +11,6 @@ const static uint32_t baud_rates[] = {
 };
 
 uint32_t
-terminal_config_get_baud_rate(struct terminal_config *terminal_config) {
+terminal_config_get_baud_rate(const struct terminal_config *terminal_config) {
   return baud_rates[terminal_config->baud_rate];
 }
@@ -43,6 +43,12 @@ enum parity {
   PARITY_ODD = 2,
 };
 
+enum flow_control {
+  FLOW_CONTROL_NONE = 0,
+  FLOW_CONTROL_XON_XOFF = 1,
+  FLOW_CONTROL_RTS_CTS = 2,
+};
+
 enum c1_mode {
   C1_MODE_7BIT = 0,
   C1_MODE_8BIT = 1,
@@ -95,7 +101,7 @@ struct terminal_config {
 #endif
   enum stop_bits stop_bits;
   enum parity parity;
-  bool flow_control;
+  enum flow_control flow_control;
 #ifdef TERMINAL_SERIAL_INVERTED
   bool serial_inverted;
 #endif
@@ -121,4 +127,5 @@ struct terminal_config {
   enum start_up start_up;
 };
 
-uint32_t terminal_config_get_baud_rate(struct terminal_config *terminal_config);
+uint32_t
+terminal_config_get_baud_rate(const struct terminal_config *terminal_config);
@@ -347,8 +347,13 @@ static const struct terminal_ui_menu menus[] = {
               {"VT220"},
               {NULL},
           }},
-         {"XOFF/XON flow control", current_flow_control, change_flow_control,
-          &off_on_choices},
+         {"Flow control", current_flow_control, change_flow_control,
+          &(const struct terminal_ui_choice[]){
+              [FLOW_CONTROL_NONE] = {"off"},
+              [FLOW_CONTROL_XON_XOFF] = {"XOFF/XON"},
+              [FLOW_CONTROL_RTS_CTS] = {"RTS/CTS"},
+              {NULL},
+          }},
          {"Receive controls", current_receive_c1_mode, change_receive_c1_mode,
           &c1_mode_choices},
          {"Transmit controls", current_transmit_c1_mode,
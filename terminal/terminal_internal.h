@@ -8,8 +8,38 @@
 #define ROWS terminal->format.rows
 #define COLS terminal->format.cols
 
+#define TERMINAL_RESPONSE_SIZE 64
+
+// Fixed-size builder for reports and key sequences, so that each goes to the
+// transmitter as a single span without going through printf. One that
+// overflows is not sent at all rather than cut short.
+struct terminal_response {
+  character_t data[TERMINAL_RESPONSE_SIZE];
+  size_t size;
+  bool overflow;
+};
+
+void terminal_response_init(struct terminal_response *response);
+
+void terminal_response_add_character(struct terminal_response *response,
+                                     character_t character);
+
+void terminal_response_add_string(struct terminal_response *response,
+                                  const char *string);
+
+void terminal_response_add_number(struct terminal_response *response,
+                                  unsigned int number);
+
+bool terminal_uart_transmit_response(struct terminal *terminal,
+                                     const struct terminal_response *response);
+
 void terminal_uart_init(struct terminal *terminal);
 
+// Sends XOFF or XON ahead of anything queued. Returns false if it could not
+// be sent.
+bool terminal_uart_transmit_flow_character(struct terminal *terminal,
+                                           character_t character);
+
 void terminal_uart_xon_off(struct terminal *terminal, enum xon_off xon_off);
 
 void terminal_keyboard_init(struct terminal *terminal,
@@ -27,6 +57,8 @@ void terminal_screen_update_cursor_counter(struct terminal *terminal);
 
 void terminal_screen_update_blink_counter(struct terminal *terminal);
 
+void terminal_screen_update_synchronized_counter(struct terminal *terminal);
+
 void terminal_screen_move_cursor_absolute(struct terminal *terminal,
                                           int16_t row, int16_t col);
 
@@ -57,6 +89,10 @@ void terminal_screen_reverse_index(struct terminal *terminal, int16_t rows);
 void terminal_screen_put_codepoint(struct terminal *terminal,
                                    codepoint_t codepoint);
 
+void terminal_screen_put_codepoints(struct terminal *terminal,
+                                    const codepoint_t *codepoints,
+                                    size_t count);
+
 void terminal_screen_enable_cursor(struct terminal *terminal, bool enable);
 
 void terminal_screen_save_visual_state(struct terminal *terminal);
@@ -71,6 +107,10 @@ void terminal_screen_erase(struct terminal *terminal, size_t cols);
 
 void terminal_screen_set_screen_mode(struct terminal *terminal, bool mode);
 
+void terminal_screen_begin_synchronized_update(struct terminal *terminal);
+
+void terminal_screen_end_synchronized_update(struct terminal *terminal);
+
 void terminal_screen_wrap_last_col(struct terminal *terminal);
 
 void terminal_screen_cancel_wrap_last_col(struct terminal *terminal);
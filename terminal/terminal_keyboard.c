@@ -2,12 +2,10 @@
 
 #include "terminal_keyboard.h"
 #include <ctype.h>
-#include <stdio.h>
 #include <string.h>
 
 #define FIRST_REPEAT_COUNTER 500
 #define NEXT_REPEAT_COUNTER 33
-#define ESCAPE_KEY_BUFFER_SIZE 16
 
 static size_t get_case(struct terminal *terminal) {
   return terminal->lock_state.caps ^ terminal->shift_state;
@@ -75,14 +73,23 @@ static void handle_ctrl_alt_delete(struct terminal *terminal) {
   terminal->callbacks->activate_config();
 }
 
+// Holds the host off for as long as scroll lock is on, the same way flow
+// control does. Automatic flow control leaves the line alone meanwhile, so on
+// release the host is only let go if it would not be held off anyway. The
+// lock only changes once XOFF or XON has gone out, so a key press that could
+// not be sent leaves the lock, and its LED, as they were.
 static void update_scroll_lock(struct terminal *terminal, bool scroll_lock) {
+  if (terminal->flow_control == FLOW_CONTROL_RTS_CTS)
+    terminal->callbacks->uart_set_rts(!scroll_lock &&
+                                      terminal->xon_off == XON);
+  else if (scroll_lock || terminal->xon_off == XON) {
+    if (!terminal_uart_transmit_flow_character(
+            terminal, scroll_lock ? CHAR_XOFF : CHAR_XON))
+      return;
+  }
+
   terminal->lock_state.scroll = scroll_lock;
   terminal_keyboard_update_leds(terminal);
-
-  if (terminal->lock_state.scroll)
-    terminal_uart_transmit_character(terminal, CHAR_XOFF);
-  else
-    terminal_uart_transmit_character(terminal, CHAR_XON);
 }
 
 static void handle_scroll_lock(struct terminal *terminal) {
@@ -967,19 +974,18 @@ static void transmit_escape_key(struct terminal *terminal, character_t control,
                                 const char *string, size_t mod_prepend_1s,
                                 bool mod_force_csi) {
   size_t l = strlen(string);
-  char buffer[ESCAPE_KEY_BUFFER_SIZE];
-  memset(buffer, 0, ESCAPE_KEY_BUFFER_SIZE);
-  size_t i = 0;
+  struct terminal_response response;
 
-  buffer[i++] = '\033';
+  terminal_response_init(&response);
+  terminal_response_add_character(&response, '\033');
 
   if (control) {
     if (mod_force_csi &&
         (terminal->shift_state || terminal_keyboard_get_alt_state(terminal) ||
          terminal->ctrl_state))
-      buffer[i++] = '[';
+      terminal_response_add_character(&response, '[');
     else
-      buffer[i++] = control;
+      terminal_response_add_character(&response, control);
   }
 
   while (l--) {
@@ -989,30 +995,29 @@ static void transmit_escape_key(struct terminal *terminal, character_t control,
                          (terminal->ctrl_state << 2);
       if (modifier) {
 
-        if (isdigit((int)buffer[i - 1]))
-          buffer[i++] = ';';
+        if (isdigit((int)response.data[response.size - 1]))
+          terminal_response_add_character(&response, ';');
 
-        while (mod_prepend_1s--) {
-          buffer[i++] = '1';
-          buffer[i++] = ';';
-        }
+        while (mod_prepend_1s--)
+          terminal_response_add_string(&response, "1;");
 
-        i += sprintf(buffer + i, "%d", modifier + 1);
+        terminal_response_add_number(&response, modifier + 1);
       }
     }
 
-    buffer[i++] = *(string++);
+    terminal_response_add_character(&response, *(string++));
   }
 
-  terminal_uart_transmit_string(terminal, buffer);
+  terminal_uart_transmit_response(terminal, &response);
 }
 
 static void transmit_character_key(struct terminal *terminal,
                                    character_t character) {
-  if (terminal_keyboard_get_alt_state(terminal))
-    terminal_uart_transmit_character(terminal, '\033');
+  // Sent as is: ESC and the character together must not become a C1 control.
+  character_t characters[] = {'\033', character};
+  bool alt = terminal_keyboard_get_alt_state(terminal);
 
-  terminal_uart_transmit_character(terminal, character);
+  terminal->callbacks->uart_transmit(characters + !alt, 1 + alt);
 }
 
 static void transmit_string_key(struct terminal *terminal, const char *string) {
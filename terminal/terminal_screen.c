@@ -1,5 +1,6 @@
 #include "terminal_internal.h"
 
+#include <stdint.h>
 #include <string.h>
 
 #define CURSOR_ON_COUNTER 650
@@ -8,10 +9,19 @@
 #define BLINK_ON_COUNTER 500
 #define BLINK_OFF_COUNTER 500
 
+// How long a synchronized update may hold the screen back, in timer ticks.
+#define SYNCHRONIZED_UPDATE_COUNTER 200
+
 #define CELL_SIZE sizeof(struct visual_cell)
 #define CELLS_ROW_SIZE (CELL_SIZE * COLS)
 #define CELLS_SIZE (CELLS_ROW_SIZE * ROWS)
 
+// Screen rows are looked up through row_map, so scrolling a region only
+// rotates its entries.
+static struct visual_cell *row_cells(struct terminal *terminal, int16_t row) {
+  return terminal->cells + terminal->row_map[row] * COLS;
+}
+
 static void clear_cells_rows(struct terminal *terminal, int16_t from_row,
                              int16_t to_row) {
   if (to_row <= from_row)
@@ -20,11 +30,9 @@ static void clear_cells_rows(struct terminal *terminal, int16_t from_row,
   if (to_row > ROWS)
     return;
 
-  uint16_t rows = to_row - from_row;
-  size_t offset = from_row * COLS;
-  struct visual_cell *cells = terminal->cells + offset;
+  for (int16_t row = from_row; row < to_row; ++row) {
+    struct visual_cell *cells = row_cells(terminal, row);
 
-  for (uint16_t i = 0; i < rows; ++i) {
     memset(cells, 0, CELLS_ROW_SIZE);
 
     for (size_t k = 0; k < COLS; ++k, cells++) {
@@ -47,8 +55,7 @@ static void clear_cells_cols(struct terminal *terminal, int16_t row,
   if (to_col > COLS)
     return;
 
-  size_t offset = row * COLS + from_col;
-  struct visual_cell *cells = terminal->cells + offset;
+  struct visual_cell *cells = row_cells(terminal, row) + from_col;
 
   memset(cells, 0, CELL_SIZE * (to_col - from_col));
 
@@ -71,29 +78,21 @@ static void scroll_cells(struct terminal *terminal, enum scroll scroll,
     return;
   }
 
-  size_t disp = COLS * rows;
+  uint8_t *map = terminal->row_map + from_row;
   uint16_t rows_diff = to_row - from_row - rows;
+  uint8_t tmp[TERMINAL_MAX_ROWS];
 
+  // The rows scrolled out are reused for the rows scrolled in.
   if (scroll == SCROLL_DOWN) {
-    size_t offset = COLS * to_row - COLS;
-    struct visual_cell *cells = terminal->cells + offset;
-
-    for (uint16_t i = 0; i < rows_diff; ++i, cells -= COLS) {
-      memcpy(cells, cells - disp, CELLS_ROW_SIZE);
-
-      terminal->callbacks->yield();
-    }
+    memcpy(tmp, map + rows_diff, rows);
+    memmove(map + rows, map, rows_diff);
+    memcpy(map, tmp, rows);
 
     clear_cells_rows(terminal, from_row, from_row + rows);
   } else if (scroll == SCROLL_UP) {
-    size_t offset = COLS * from_row;
-    struct visual_cell *cells = terminal->cells + offset;
-
-    for (uint16_t i = 0; i < rows_diff; ++i, cells += COLS) {
-      memcpy(cells, cells + disp, CELLS_ROW_SIZE);
-
-      terminal->callbacks->yield();
-    }
+    memcpy(tmp, map, rows);
+    memmove(map, map + rows, rows_diff);
+    memcpy(map + rows_diff, tmp, rows);
 
     clear_cells_rows(terminal, to_row - rows, to_row);
   }
@@ -111,8 +110,7 @@ static void shift_cells_right(struct terminal *terminal, int16_t row,
     return;
 
   size_t size = CELL_SIZE * (COLS - col - cols);
-  size_t offset = COLS * row + col;
-  struct visual_cell *cells = terminal->cells + offset;
+  struct visual_cell *cells = row_cells(terminal, row) + col;
 
   struct visual_cell tmp[COLS];
 
@@ -134,8 +132,7 @@ static void shift_cells_left(struct terminal *terminal, int16_t row,
     return;
 
   size_t size = CELL_SIZE * (COLS - col - cols);
-  size_t offset = COLS * row + col;
-  struct visual_cell *cells = terminal->cells + offset;
+  struct visual_cell *cells = row_cells(terminal, row) + col;
 
   memcpy(cells, cells + cols, size);
 
@@ -144,7 +141,7 @@ static void shift_cells_left(struct terminal *terminal, int16_t row,
 
 struct visual_cell *get_cell(struct terminal *terminal, int16_t row,
                              int16_t col) {
-  return &terminal->cells[row * COLS + col];
+  return row_cells(terminal, row) + col;
 }
 
 static void swap_colors(color_t *color1, color_t *color2) {
@@ -153,30 +150,195 @@ static void swap_colors(color_t *color1, color_t *color2) {
   *color2 = tmp;
 }
 
-static void render_character(struct terminal *terminal, int16_t row,
-                             int16_t col, bool cursor, bool blink) {
-  struct visual_cell *cell = get_cell(terminal, row, col);
+static void mark_dirty(struct terminal *terminal, int16_t row, int16_t col) {
+  terminal->dirty_cells[row][col / 8] |= 1 << (col % 8);
+}
+
+static void mark_dirty_rows(struct terminal *terminal, int16_t from_row,
+                            int16_t to_row) {
+  if (to_row <= from_row)
+    return;
+
+  if (to_row > ROWS)
+    return;
+
+  memset(terminal->dirty_cells[from_row], 0xff,
+         TERMINAL_DIRTY_ROW_SIZE * (to_row - from_row));
+}
+
+static void mark_dirty_cols(struct terminal *terminal, int16_t row,
+                            int16_t from_col, int16_t to_col) {
+  if (row >= ROWS)
+    return;
+
+  if (to_col > COLS)
+    return;
+
+  for (int16_t col = from_col; col < to_col; ++col)
+    mark_dirty(terminal, row, col);
+}
+
+// Keeps dirty bits attached to their cells when the framebuffer rows are
+// moved; rows vacated by the scroll are cleared on screen and so are clean.
+static void scroll_dirty(struct terminal *terminal, enum scroll scroll,
+                         int16_t from_row, int16_t to_row, int16_t rows) {
+  if (to_row <= from_row)
+    return;
+
+  if (to_row > ROWS)
+    return;
+
+  if (to_row <= from_row + rows) {
+    memset(terminal->dirty_cells[from_row], 0,
+           TERMINAL_DIRTY_ROW_SIZE * (to_row - from_row));
+    return;
+  }
 
-  color_t active = cell->p.active_color;
-  color_t inactive = cell->p.inactive_color;
+  size_t size = TERMINAL_DIRTY_ROW_SIZE * (to_row - from_row - rows);
+
+  if (scroll == SCROLL_DOWN) {
+    memmove(terminal->dirty_cells[from_row + rows],
+            terminal->dirty_cells[from_row], size);
+    memset(terminal->dirty_cells[from_row], 0, TERMINAL_DIRTY_ROW_SIZE * rows);
+  } else if (scroll == SCROLL_UP) {
+    memmove(terminal->dirty_cells[from_row],
+            terminal->dirty_cells[from_row + rows], size);
+    memset(terminal->dirty_cells[to_row - rows], 0,
+           TERMINAL_DIRTY_ROW_SIZE * rows);
+  }
+}
+
+static void cell_colors(struct terminal *terminal, struct visual_cell *cell,
+                        bool cursor, bool blink, color_t *active,
+                        color_t *inactive) {
+  *active = cell->p.active_color;
+  *inactive = cell->p.inactive_color;
 
   if (cell->p.negative != terminal->screen_mode)
-    swap_colors(&active, &inactive);
+    swap_colors(active, inactive);
 
   if (cursor) {
-    active = ~active;
-    inactive = ~inactive;
+    *active = ~*active;
+    *inactive = ~*inactive;
   }
 
   if (terminal->vs.p.concealed || blink) {
-    active = inactive;
+    *active = *inactive;
   }
+}
+
+static void drawn_cell_colors(struct terminal *terminal, int16_t row,
+                              int16_t col, color_t *active,
+                              color_t *inactive) {
+  struct visual_cell *cell = get_cell(terminal, row, col);
+
+  cell_colors(terminal, cell,
+              terminal->cursor_drawn && terminal->vs.cursor_row == row &&
+                  terminal->vs.cursor_col == col,
+              terminal->blink_drawn && cell->p.blink, active, inactive);
+}
+
+// Hands the scrolls jump scrolling has added up to screen_scroll. Jump
+// scrolling is only used with deferred rendering, where nothing else reaches
+// the screen before the next flush, which starts here.
+static void flush_scroll(struct terminal *terminal) {
+  if (!terminal->pending_scroll_rows)
+    return;
+
+  terminal->callbacks->screen_scroll(
+      terminal->format, terminal->pending_scroll, terminal->pending_scroll_from,
+      terminal->pending_scroll_to, terminal->pending_scroll_rows,
+      terminal->pending_scroll_inactive);
+
+  terminal->pending_scroll_rows = 0;
+}
+
+static void draw_character(struct terminal *terminal, int16_t row, int16_t col,
+                           bool cursor, bool blink) {
+  struct visual_cell *cell = get_cell(terminal, row, col);
+
+  color_t active, inactive;
+  cell_colors(terminal, cell, cursor, blink, &active, &inactive);
 
   terminal->callbacks->screen_draw_codepoint(
       terminal->format, row, col, cell->c, cell->p.font, cell->p.italic,
       cell->p.underlined, cell->p.crossedout, active, inactive);
 }
 
+static bool same_style(struct visual_cell *cell1, struct visual_cell *cell2) {
+  return cell1->p.font == cell2->p.font &&
+         cell1->p.italic == cell2->p.italic &&
+         cell1->p.underlined == cell2->p.underlined &&
+         cell1->p.crossedout == cell2->p.crossedout;
+}
+
+// Draws cells from_col to to_col of a row with their current cursor and blink
+// state, handing runs of identically styled cells to screen_draw_run when the
+// callback is provided.
+static void draw_characters(struct terminal *terminal, int16_t row,
+                            int16_t from_col, int16_t to_col) {
+  if (!terminal->callbacks->screen_draw_run) {
+    for (int16_t col = from_col; col < to_col; ++col) {
+      struct visual_cell *cell = get_cell(terminal, row, col);
+      draw_character(terminal, row, col,
+                     terminal->cursor_drawn &&
+                         terminal->vs.cursor_row == row &&
+                         terminal->vs.cursor_col == col,
+                     terminal->blink_drawn && cell->p.blink);
+    }
+
+    return;
+  }
+
+  codepoint_t codepoints[TERMINAL_MAX_COLS];
+  int16_t col = from_col;
+
+  while (col < to_col) {
+    struct visual_cell *cell = get_cell(terminal, row, col);
+    int16_t run_col = col;
+    size_t count = 0;
+
+    color_t active, inactive;
+    drawn_cell_colors(terminal, row, col, &active, &inactive);
+
+    codepoints[count++] = cell->c;
+
+    for (++col; col < to_col; ++col) {
+      struct visual_cell *next = get_cell(terminal, row, col);
+
+      color_t next_active, next_inactive;
+      drawn_cell_colors(terminal, row, col, &next_active, &next_inactive);
+
+      if (!same_style(cell, next) || next_active != active ||
+          next_inactive != inactive)
+        break;
+
+      codepoints[count++] = next->c;
+    }
+
+    terminal->callbacks->screen_draw_run(
+        terminal->format, row, run_col, codepoints, count, cell->p.font,
+        cell->p.italic, cell->p.underlined, cell->p.crossedout, active,
+        inactive);
+  }
+}
+
+static void render_character(struct terminal *terminal, int16_t row,
+                             int16_t col, bool cursor, bool blink) {
+  if (terminal->deferred_render)
+    mark_dirty(terminal, row, col);
+  else
+    draw_character(terminal, row, col, cursor, blink);
+}
+
+static void render_characters(struct terminal *terminal, int16_t row,
+                              int16_t from_col, int16_t to_col) {
+  if (terminal->deferred_render)
+    mark_dirty_cols(terminal, row, from_col, to_col);
+  else
+    draw_characters(terminal, row, from_col, to_col);
+}
+
 static void draw_cursor(struct terminal *terminal) {
   if (!terminal->cursor_drawn) {
     render_character(
@@ -246,14 +408,7 @@ static void draw_codepoint(struct terminal *terminal, codepoint_t codepoint) {
 
 static void draw_screen(struct terminal *terminal) {
   for (int16_t row = 0; row < ROWS; ++row)
-    for (int16_t col = 0; col < COLS; ++col) {
-      struct visual_cell *cell = get_cell(terminal, row, col);
-      render_character(terminal, row, col,
-                       terminal->cursor_drawn &&
-                           terminal->vs.cursor_row == row &&
-                           terminal->vs.cursor_col == col,
-                       terminal->blink_drawn && cell->p.blink);
-    }
+    render_characters(terminal, row, 0, COLS);
 }
 
 static color_t inactive_color(struct terminal *terminal) {
@@ -265,16 +420,22 @@ static color_t inactive_color(struct terminal *terminal) {
 
 static void clear_rows(struct terminal *terminal, int16_t from_row,
                        int16_t to_row) {
-  terminal->callbacks->screen_clear_rows(terminal->format, from_row, to_row,
-                                         inactive_color(terminal));
+  if (terminal->deferred_render)
+    mark_dirty_rows(terminal, from_row, to_row);
+  else
+    terminal->callbacks->screen_clear_rows(terminal->format, from_row, to_row,
+                                           inactive_color(terminal));
 
   clear_cells_rows(terminal, from_row, to_row);
 }
 
 static void clear_cols(struct terminal *terminal, int16_t row, int16_t from_col,
                        int16_t to_col) {
-  terminal->callbacks->screen_clear_cols(terminal->format, row, from_col,
-                                         to_col, inactive_color(terminal));
+  if (terminal->deferred_render)
+    mark_dirty_cols(terminal, row, from_col, to_col);
+  else
+    terminal->callbacks->screen_clear_cols(terminal->format, row, from_col,
+                                           to_col, inactive_color(terminal));
 
   clear_cells_cols(terminal, row, from_col, to_col);
 }
@@ -282,11 +443,48 @@ static void clear_cols(struct terminal *terminal, int16_t row, int16_t from_col,
 static void screen_scroll(struct terminal *terminal, enum scroll scroll,
                           int16_t from_row, int16_t rows) {
   if (from_row < terminal->margin_bottom) {
-    terminal->callbacks->screen_scroll(terminal->format, scroll, from_row,
-                                       terminal->margin_bottom, rows,
-                                       inactive_color(terminal));
+    int16_t to_row = terminal->margin_bottom;
+    color_t inactive = inactive_color(terminal);
+
+    if (terminal->pending_scroll_rows &&
+        (terminal->pending_scroll != scroll ||
+         terminal->pending_scroll_from != from_row ||
+         terminal->pending_scroll_to != to_row ||
+         terminal->pending_scroll_inactive != inactive)) {
+      // A synchronized update keeps its hands off the framebuffer: rather
+      // than scrolling it now, the rows the pending scroll covers are drawn
+      // afresh by the flush at the end.
+      if (terminal->synchronized_update) {
+        mark_dirty_rows(terminal, terminal->pending_scroll_from,
+                        terminal->pending_scroll_to);
+        terminal->pending_scroll_rows = 0;
+      } else {
+        flush_scroll(terminal);
+      }
+    }
+
+    if (terminal->synchronized_update ||
+        (terminal->deferred_render &&
+         (!terminal->scrolling_mode || terminal->jump_scroll_backlog))) {
+      terminal->pending_scroll = scroll;
+      terminal->pending_scroll_from = from_row;
+      terminal->pending_scroll_to = to_row;
+      terminal->pending_scroll_inactive = inactive;
+
+      // Scrolling the whole region or more clears it either way.
+      terminal->pending_scroll_rows += rows;
+      if (terminal->pending_scroll_rows > to_row - from_row)
+        terminal->pending_scroll_rows = to_row - from_row;
+    } else {
+      flush_scroll(terminal);
+      terminal->callbacks->screen_scroll(terminal->format, scroll, from_row,
+                                         to_row, rows, inactive);
+    }
 
     scroll_cells(terminal, scroll, from_row, terminal->margin_bottom, rows);
+
+    if (terminal->deferred_render)
+      scroll_dirty(terminal, scroll, from_row, terminal->margin_bottom, rows);
   }
 }
 
@@ -534,13 +732,70 @@ void terminal_screen_put_codepoint(struct terminal *terminal,
   update_cursor(terminal);
 }
 
+void terminal_screen_put_codepoints(struct terminal *terminal,
+                                    const codepoint_t *codepoints,
+                                    size_t count) {
+  if (terminal->insert_mode) {
+    while (count--)
+      terminal_screen_put_codepoint(terminal, *codepoints++);
+
+    return;
+  }
+
+  clear_cursor(terminal);
+
+  while (count) {
+    if (terminal->vs.cursor_last_col) {
+      terminal_screen_wrap_last_col(terminal);
+      clear_cursor(terminal);
+    }
+
+    size_t cols = COLS - terminal->vs.cursor_col;
+    if (cols > count)
+      cols = count;
+
+    struct visual_cell *cell =
+        get_cell(terminal, terminal->vs.cursor_row, terminal->vs.cursor_col);
+
+    for (size_t i = 0; i < cols; ++i, ++cell) {
+      cell->p = terminal->vs.p;
+      cell->c = *codepoints++;
+    }
+
+    render_characters(terminal, terminal->vs.cursor_row,
+                      terminal->vs.cursor_col, terminal->vs.cursor_col + cols);
+    terminal->vs.cursor_col += cols;
+
+    count -= cols;
+
+    if (terminal->vs.cursor_col == COLS) {
+      terminal->vs.cursor_col = COLS - 1;
+
+      if (terminal->auto_wrap_mode)
+        terminal->vs.cursor_last_col = true;
+      else if (count) {
+        // Without wraparound the rest of the run lands on the last column,
+        // so only its final codepoint stays visible.
+        draw_codepoint(terminal, codepoints[count - 1]);
+        count = 0;
+      }
+    }
+  }
+
+  update_cursor(terminal);
+}
+
 void terminal_screen_insert(struct terminal *terminal, size_t cols) {
   clear_cursor(terminal);
   clear_blink(terminal);
 
-  terminal->callbacks->screen_shift_right(
-      terminal->format, terminal->vs.cursor_row, terminal->vs.cursor_col, cols,
-      inactive_color(terminal));
+  if (terminal->deferred_render)
+    mark_dirty_cols(terminal, terminal->vs.cursor_row, terminal->vs.cursor_col,
+                    COLS);
+  else
+    terminal->callbacks->screen_shift_right(
+        terminal->format, terminal->vs.cursor_row, terminal->vs.cursor_col,
+        cols, inactive_color(terminal));
 
   shift_cells_right(terminal, terminal->vs.cursor_row, terminal->vs.cursor_col,
                     cols);
@@ -553,9 +808,13 @@ void terminal_screen_delete(struct terminal *terminal, size_t cols) {
   clear_cursor(terminal);
   clear_blink(terminal);
 
-  terminal->callbacks->screen_shift_left(
-      terminal->format, terminal->vs.cursor_row, terminal->vs.cursor_col, cols,
-      inactive_color(terminal));
+  if (terminal->deferred_render)
+    mark_dirty_cols(terminal, terminal->vs.cursor_row, terminal->vs.cursor_col,
+                    COLS);
+  else
+    terminal->callbacks->screen_shift_left(
+        terminal->format, terminal->vs.cursor_row, terminal->vs.cursor_col,
+        cols, inactive_color(terminal));
 
   shift_cells_left(terminal, terminal->vs.cursor_row, terminal->vs.cursor_col,
                    cols);
@@ -641,11 +900,125 @@ void terminal_screen_update_blink_counter(struct terminal *terminal) {
   }
 }
 
+void terminal_screen_update_synchronized_counter(struct terminal *terminal) {
+  if (terminal->synchronized_counter)
+    terminal->synchronized_counter--;
+}
+
+// While the host redraws, only the cells change; once it is done, or has taken
+// too long, the flush rasterises what changed in one go, so neither the
+// intermediate states nor the time to draw them reach the screen.
+void terminal_screen_begin_synchronized_update(struct terminal *terminal) {
+  if (!terminal->synchronized_update) {
+    terminal->synchronized_update = true;
+    terminal->synchronized_deferred = !terminal->deferred_render;
+    terminal->deferred_render = true;
+  }
+
+  terminal->synchronized_counter = SYNCHRONIZED_UPDATE_COUNTER;
+}
+
+void terminal_screen_end_synchronized_update(struct terminal *terminal) {
+  if (!terminal->synchronized_update)
+    return;
+
+  terminal->synchronized_update = false;
+
+  if (terminal->synchronized_deferred)
+    terminal_screen_set_deferred_render(terminal, false);
+}
+
+static bool synchronized_update_held(struct terminal *terminal) {
+  if (terminal->synchronized_update && !terminal->synchronized_counter)
+    terminal_screen_end_synchronized_update(terminal);
+
+  return terminal->synchronized_update;
+}
+
 void terminal_screen_update(struct terminal *terminal) {
+  synchronized_update_held(terminal);
   update_cursor(terminal);
   update_blink(terminal);
 }
 
+void terminal_screen_set_deferred_render(struct terminal *terminal,
+                                         bool deferred) {
+  // Whoever calls this takes over from a synchronized update.
+  terminal->synchronized_deferred = false;
+
+  if (!deferred) {
+    terminal->synchronized_update = false;
+    terminal_screen_flush(terminal);
+  }
+
+  terminal->deferred_render = deferred;
+}
+
+static bool row_dirty(struct terminal *terminal, int16_t row) {
+  for (size_t i = 0; i < TERMINAL_DIRTY_ROW_SIZE; ++i)
+    if (terminal->dirty_cells[row][i])
+      return true;
+
+  return false;
+}
+
+static size_t flush_row(struct terminal *terminal, int16_t row) {
+  uint8_t *dirty = terminal->dirty_cells[row];
+  int16_t from_col = -1;
+  size_t drawn = 0;
+
+  for (int16_t col = 0; col <= COLS; ++col) {
+    if (col < COLS && (dirty[col / 8] & (1 << (col % 8)))) {
+      if (from_col < 0)
+        from_col = col;
+    } else if (from_col >= 0) {
+      draw_characters(terminal, row, from_col, col);
+      drawn += col - from_col;
+      from_col = -1;
+    }
+  }
+
+  memset(dirty, 0, TERMINAL_DIRTY_ROW_SIZE);
+  terminal->callbacks->yield();
+
+  return drawn;
+}
+
+void terminal_screen_flush(struct terminal *terminal) {
+  terminal_screen_flush_slice(terminal, SIZE_MAX);
+}
+
+// Rasterises dirty rows until at least budget cells have been drawn, so that
+// the main loop gets back to the receive buffer after a bounded amount of
+// work however much of the screen an escape sequence touched. The next slice
+// carries on from the row after, so every row gets its turn. Returns whether
+// it stopped early.
+bool terminal_screen_flush_slice(struct terminal *terminal, size_t budget) {
+  size_t drawn = 0;
+
+  if (synchronized_update_held(terminal))
+    return false;
+
+  flush_scroll(terminal);
+
+  if (terminal->flush_row >= ROWS)
+    terminal->flush_row = 0;
+
+  for (int16_t rows = 0; rows < ROWS; ++rows) {
+    int16_t row = terminal->flush_row;
+
+    if (row_dirty(terminal, row))
+      drawn += flush_row(terminal, row);
+
+    terminal->flush_row = row + 1 < ROWS ? row + 1 : 0;
+
+    if (drawn >= budget)
+      return true;
+  }
+
+  return false;
+}
+
 void terminal_screen_set_screen_mode(struct terminal *terminal, bool mode) {
   if (terminal->screen_mode != mode) {
     terminal->screen_mode = mode;
@@ -655,11 +1028,18 @@ void terminal_screen_set_screen_mode(struct terminal *terminal, bool mode) {
 
 #ifdef TERMINAL_ALT_CELLS
 void terminal_screen_use_alt_cells(struct terminal *terminal) {
+  // The alt cells are cleared, so only the map of the default ones is kept.
+  if (terminal->cells == terminal->default_cells)
+    memcpy(terminal->default_row_map, terminal->row_map,
+           sizeof(terminal->row_map));
   terminal->cells = terminal->alt_cells;
   terminal_screen_clear_all(terminal);
 }
 
 void terminal_screen_restore_default_cells(struct terminal *terminal) {
+  if (terminal->cells == terminal->alt_cells)
+    memcpy(terminal->row_map, terminal->default_row_map,
+           sizeof(terminal->row_map));
   terminal->cells = terminal->default_cells;
   draw_screen(terminal);
 }
@@ -693,7 +1073,18 @@ void terminal_screen_init(struct terminal *terminal) {
   terminal->blink_on = true;
   terminal->blink_drawn = false;
 
+  terminal->deferred_render = false;
+  memset(terminal->dirty_cells, 0, sizeof(terminal->dirty_cells));
+  terminal->flush_row = 0;
+  terminal->jump_scroll_backlog = false;
+  terminal->pending_scroll_rows = 0;
+  terminal->synchronized_update = false;
+  terminal->synchronized_deferred = false;
+  terminal->synchronized_counter = 0;
+
   terminal->cells = terminal->default_cells;
+  for (size_t row = 0; row < TERMINAL_MAX_ROWS; row++)
+    terminal->row_map[row] = row;
   terminal_screen_clear_all(terminal);
   update_cursor(terminal);
 }
@@ -1,33 +1,52 @@
 #include "terminal_internal.h"
 
-#include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
 
-#define PRINTF_BUFFER_SIZE 64
+#include "receive_tables.h"
 
 #define DECRQSS_PREFIX "$q"
 #define DECRQSS_PREFIX_LENGTH 2
 
-#define XOFF_LIMIT 256
-#define XON_LIMIT 128
+// How long the host keeps sending after being asked to stop, or takes to
+// start again: XOFF goes through its serial driver, RTS is mostly handled by
+// its UART.
+#define XOFF_LATENCY_US 20000
+#define RTS_LATENCY_US 2000
 
-#define DEFAULT_RECEIVE CHARACTER_MAX
+// Bytes allowed for on top, for the host's transmit FIFO.
+#define FLOW_SLACK 64
+
+// Consume rate measurement window, in timer ticks.
+#define FLOW_WINDOW_TICKS 64
+
+// Receive backlog, in bytes, beyond which scrolling jumps even with DECSCLM
+// set: a couple of screens of text the panel would only scroll past.
+#define JUMP_SCROLL_BACKLOG 4096
+
+#define PRINTABLE_RUN_LENGTH 80
+
+#if ESC_MAX_PARAMS_COUNT > 16
+#error "esc_subparams has a bit for each of ESC_MAX_PARAMS_COUNT"
+#endif
 
 static void clear_esc_params(struct terminal *terminal) {
-  memset(terminal->esc_params, 0, ESC_MAX_PARAMS_COUNT * ESC_MAX_PARAM_LENGTH);
   terminal->esc_params_count = 0;
-  terminal->esc_last_param_length = 0;
+  terminal->esc_subparams = 0;
+  terminal->esc_param_started = false;
+  terminal->esc_colon_pending = false;
   terminal->vt52_move_cursor_row = 0;
 }
 
+// Missing parameters read as zero, the default for every sequence.
 static int16_t get_esc_param(struct terminal *terminal, size_t index) {
-  return atoi((const char *)terminal->esc_params[index]);
+  return index < terminal->esc_params_count ? terminal->esc_params[index] : 0;
 }
 
-static const receive_table_t utf8_prefix_receive_table;
-static const receive_table_t utf8_continuation_receive_table;
-static const receive_table_t one_byte_receive_table;
+static bool is_esc_subparam(struct terminal *terminal, size_t index) {
+  return index < terminal->esc_params_count &&
+         (terminal->esc_subparams & (1 << index));
+}
 
 static bool codepoint_receive_table(struct terminal *terminal) {
   return (terminal->receive_table == &utf8_prefix_receive_table ||
@@ -54,9 +73,6 @@ static void clear_receive_table(struct terminal *terminal) {
 #endif
 }
 
-static const receive_table_t esc_receive_table;
-static const receive_table_t vt52_esc_receive_table;
-
 static void cancel_esc(struct terminal *terminal) {
   if (!codepoint_receive_table(terminal)) {
 #ifdef DEBUG
@@ -222,26 +238,18 @@ static void receive_ls3(struct terminal *terminal, character_t character) {
   clear_receive_table(terminal);
 }
 
-static const receive_table_t csi_receive_table;
-
 static void receive_csi(struct terminal *terminal, character_t character) {
   terminal->receive_table = &csi_receive_table;
 }
 
-static const receive_table_t esc_hash_receive_table;
-
 static void receive_hash(struct terminal *terminal, character_t character) {
   terminal->receive_table = &esc_hash_receive_table;
 }
 
-static const receive_table_t esc_space_receive_table;
-
 static void receive_space(struct terminal *terminal, character_t character) {
   terminal->receive_table = &esc_space_receive_table;
 }
 
-static const receive_table_t esc_percent_receive_table;
-
 static void receive_percent(struct terminal *terminal, character_t character) {
   terminal->receive_table = &esc_percent_receive_table;
 }
@@ -284,8 +292,6 @@ static void receive_ris(struct terminal *terminal, character_t character) {
   terminal->callbacks->reset();
 }
 
-static const receive_table_t scs_receive_table;
-
 static const uint8_t scs_gset_decode_table[CHARACTER_DECODER_TABLE_LENGTH] = {
     ['('] = GSET_G0,
     [')'] = GSET_G1,
@@ -366,35 +372,45 @@ static void receive_scs_set(struct terminal *terminal, character_t character) {
   clear_receive_table(terminal);
 }
 
+static bool add_esc_param(struct terminal *terminal) {
+  if (terminal->esc_params_count == ESC_MAX_PARAMS_COUNT)
+    return false;
+
+  if (terminal->esc_colon_pending)
+    terminal->esc_subparams |= 1 << terminal->esc_params_count;
+
+  terminal->esc_params[terminal->esc_params_count++] = 0;
+  terminal->esc_colon_pending = false;
+
+  return true;
+}
+
 static void receive_esc_param(struct terminal *terminal,
                               character_t character) {
-  if (!terminal->esc_last_param_length) {
-    if (terminal->esc_params_count == ESC_MAX_PARAMS_COUNT)
+  if (!terminal->esc_param_started) {
+    if (!add_esc_param(terminal))
       return;
 
-    terminal->esc_params_count++;
+    terminal->esc_param_started = true;
   }
 
-  // Keep zero for the end of the string for atoi
-  if (terminal->esc_last_param_length == ESC_MAX_PARAM_LENGTH - 1)
-    return;
+  uint16_t *param = &terminal->esc_params[terminal->esc_params_count - 1];
+  uint32_t value = *param * 10 + (character - '0');
 
-  terminal->esc_last_param_length++;
-  terminal->esc_params[terminal->esc_params_count - 1]
-                      [terminal->esc_last_param_length - 1] = character;
+  *param = value > ESC_MAX_PARAM_VALUE ? ESC_MAX_PARAM_VALUE : value;
 }
 
+// Both ';' and ':' end a parameter; after a colon the next one is a
+// subparameter, as in 38:2::r:g:b.
 static void receive_esc_param_delimiter(struct terminal *terminal,
                                         character_t character) {
-  if (!terminal->esc_last_param_length) {
-    if (terminal->esc_params_count == ESC_MAX_PARAMS_COUNT)
+  if (!terminal->esc_param_started) {
+    if (!add_esc_param(terminal))
       return;
-
-    terminal->esc_params_count++;
-    return;
   }
 
-  terminal->esc_last_param_length = 0;
+  terminal->esc_param_started = false;
+  terminal->esc_colon_pending = character == ':';
 }
 
 static void receive_rep(struct terminal *terminal, character_t character) {
@@ -558,9 +574,17 @@ static void receive_dsr(struct terminal *terminal, character_t character) {
     break;
 
   case 6: {
-    terminal_uart_transmit_printf(terminal, "\x1b[%d;%dR",
-                                  get_terminal_screen_cursor_row(terminal) + 1,
-                                  get_terminal_screen_cursor_col(terminal) + 1);
+    struct terminal_response response;
+
+    terminal_response_init(&response);
+    terminal_response_add_string(&response, "\x1b[");
+    terminal_response_add_number(&response,
+                                 get_terminal_screen_cursor_row(terminal) + 1);
+    terminal_response_add_character(&response, ';');
+    terminal_response_add_number(&response,
+                                 get_terminal_screen_cursor_col(terminal) + 1);
+    terminal_response_add_character(&response, 'R');
+    terminal_uart_transmit_response(terminal, &response);
   } break;
 
 #ifdef DEBUG
@@ -586,14 +610,16 @@ static void receive_cup(struct terminal *terminal, character_t character) {
 }
 
 static color_t get_sgr_color(struct terminal *terminal, size_t *i) {
+  bool colon = is_esc_subparam(terminal, *i);
   uint16_t code = get_esc_param(terminal, (*i)++);
 
   if (code == 5) {
     return get_esc_param(terminal, (*i)++);
   } else if (code == 2) {
-    get_esc_param(terminal, (*i)++);
-    get_esc_param(terminal, (*i)++);
-    get_esc_param(terminal, (*i)++);
+    // In the colon form the components, with or without the colour space
+    // before them, are skipped along with the other subparameters.
+    if (!colon)
+      *i += 3;
 
     // TODO: get the closest color from CLUT
 #ifdef DEBUG
@@ -633,7 +659,9 @@ static void handle_sgr(struct terminal *terminal, size_t *i) {
     break;
 
   case 4:
-    terminal->vs.p.underlined = true;
+    // 4:0 turns underlining off; the other styles draw a single underline.
+    terminal->vs.p.underlined =
+        !is_esc_subparam(terminal, *i) || get_esc_param(terminal, *i);
     break;
 
   case 5:
@@ -718,6 +746,9 @@ static void handle_sgr(struct terminal *terminal, size_t *i) {
       terminal->unhandled = true;
 #endif
   }
+
+  while (is_esc_subparam(terminal, *i))
+    (*i)++;
 }
 
 static void receive_sgr(struct terminal *terminal, character_t character) {
@@ -961,9 +992,19 @@ static void receive_decreqtparm(struct terminal *terminal,
     uint8_t xspeed = 120;
     uint8_t rspeed = 120;
     uint8_t clkmul = 0;
-    terminal_uart_transmit_printf(terminal, "\x1b[%d;%d;%d;%d;%d;%dx",
-                                  req == 0 ? 2 : 3, par, nbits, xspeed, rspeed,
-                                  clkmul);
+    unsigned int params[] = {req == 0 ? 2 : 3, par, nbits, xspeed, rspeed,
+                             clkmul};
+    struct terminal_response response;
+
+    terminal_response_init(&response);
+    terminal_response_add_string(&response, "\x1b[");
+    for (size_t i = 0; i < sizeof(params) / sizeof(params[0]); i++) {
+      if (i)
+        terminal_response_add_character(&response, ';');
+      terminal_response_add_number(&response, params[i]);
+    }
+    terminal_response_add_character(&response, 'x');
+    terminal_uart_transmit_response(terminal, &response);
 
     clear_receive_table(terminal);
   }
@@ -980,14 +1021,10 @@ static void receive_decaln(struct terminal *terminal, character_t character) {
   clear_receive_table(terminal);
 }
 
-static const receive_table_t csi_qm_receive_table;
-
 static void receive_csi_qm(struct terminal *terminal, character_t character) {
   terminal->receive_table = &csi_qm_receive_table;
 }
 
-static const receive_table_t csi_em_receive_table;
-
 static void receive_csi_em(struct terminal *terminal, character_t character) {
   terminal->receive_table = &csi_em_receive_table;
 }
@@ -996,8 +1033,6 @@ static void receive_decstr(struct terminal *terminal, character_t character) {
   terminal->callbacks->reset();
 }
 
-static const receive_table_t csi_gt_receive_table;
-
 static void receive_csi_gt(struct terminal *terminal, character_t character) {
   terminal->receive_table = &csi_gt_receive_table;
 }
@@ -1020,7 +1055,7 @@ static void receive_decsm(struct terminal *terminal, character_t character) {
     terminal_screen_move_cursor_absolute(terminal, 0, 0);
     break;
 
-  case 4: // DECSCKL
+  case 4: // DECSCLM
     terminal->scrolling_mode = true;
     break;
 
@@ -1068,6 +1103,10 @@ static void receive_decsm(struct terminal *terminal, character_t character) {
     terminal_screen_save_visual_state(terminal);
     break;
 
+  case 2026: // Synchronized output
+    terminal_screen_begin_synchronized_update(terminal);
+    break;
+
 #ifdef DEBUG
   default:
     terminal->unhandled = true;
@@ -1095,7 +1134,7 @@ static void receive_decrm(struct terminal *terminal, character_t character) {
     terminal_screen_move_cursor_absolute(terminal, 0, 0);
     break;
 
-  case 4: // DECSCKL
+  case 4: // DECSCLM
     terminal->scrolling_mode = false;
     break;
 
@@ -1149,6 +1188,10 @@ static void receive_decrm(struct terminal *terminal, character_t character) {
     terminal_screen_restore_visual_state(terminal);
     break;
 
+  case 2026: // Synchronized output
+    terminal_screen_end_synchronized_update(terminal);
+    break;
+
 #ifdef DEBUG
   default:
     terminal->unhandled = true;
@@ -1183,8 +1226,6 @@ static bool receive_control_data(struct control_data *control_data,
   return false;
 }
 
-static const receive_table_t osc_receive_table;
-
 static void receive_osc(struct terminal *terminal, character_t character) {
   terminal->receive_table = &osc_receive_table;
   clear_control_data(&terminal->osc);
@@ -1195,8 +1236,6 @@ static void receive_osc_data(struct terminal *terminal, character_t character) {
     clear_receive_table(terminal);
 }
 
-static const receive_table_t dcs_receive_table;
-
 static void receive_dcs(struct terminal *terminal, character_t character) {
   terminal->receive_table = &dcs_receive_table;
   clear_control_data(&terminal->dcs);
@@ -1213,8 +1252,6 @@ static void receive_dcs_data(struct terminal *terminal, character_t character) {
   }
 }
 
-static const receive_table_t apc_receive_table;
-
 static void receive_apc(struct terminal *terminal, character_t character) {
   terminal->receive_table = &apc_receive_table;
   clear_control_data(&terminal->apc);
@@ -1225,8 +1262,6 @@ static void receive_apc_data(struct terminal *terminal, character_t character) {
     clear_receive_table(terminal);
 }
 
-static const receive_table_t pm_receive_table;
-
 static void receive_pm(struct terminal *terminal, character_t character) {
   terminal->receive_table = &pm_receive_table;
   clear_control_data(&terminal->pm);
@@ -1237,15 +1272,11 @@ static void receive_pm_data(struct terminal *terminal, character_t character) {
     clear_receive_table(terminal);
 }
 
-static const receive_table_t vt52_move_cursor_row_receive_table;
-
 static void receive_vt52_move_cursor(struct terminal *terminal,
                                      character_t character) {
   terminal->receive_table = &vt52_move_cursor_row_receive_table;
 }
 
-static const receive_table_t vt52_move_cursor_col_receive_table;
-
 static void receive_vt52_move_cursor_row(struct terminal *terminal,
                                          character_t character) {
   terminal->vt52_move_cursor_row = character;
@@ -1270,51 +1301,71 @@ static void receive_vt52_ansi(struct terminal *terminal,
   clear_receive_table(terminal);
 }
 
-struct utf8_codec_entry {
-  character_t mask;
-  character_t lead;
-  size_t bits_stored;
-};
+#define UTF8_REPLACEMENT_CODEPOINT 0xfffd
 
-static const struct utf8_codec_entry *const utf8_codec[] = {
-    [0] = &(const struct utf8_codec_entry){0b00111111, 0b10000000, 6},
-    [1] = &(const struct utf8_codec_entry){0b01111111, 0b00000000, 7},
-    [2] = &(const struct utf8_codec_entry){0b00011111, 0b11000000, 5},
-    [3] = &(const struct utf8_codec_entry){0b00001111, 0b11100000, 4},
-    [4] = &(const struct utf8_codec_entry){0b00000111, 0b11110000, 3},
-    &(const struct utf8_codec_entry){0},
+enum utf8_step {
+  UTF8_ACCEPT,
+  UTF8_CONTINUE,
+  UTF8_REJECT,
 };
 
-static size_t get_utf8_codepoint_length(character_t character) {
-  int length = 0;
-
-  for (const struct utf8_codec_entry *const *e = utf8_codec; *e; ++e) {
-    if ((character & ~(*e)->mask) == (*e)->lead) {
-      break;
-    }
+// The lead byte sets how many continuation bytes follow and narrows the range
+// of the first one, which rules out overlong forms, surrogates and anything
+// past U+10FFFF (Unicode table 3-7) without a transition table.
+static enum utf8_step utf8_start(struct utf8_decoder *decoder,
+                                 character_t character) {
+  decoder->lower = 0x80;
+  decoder->upper = 0xbf;
 
-    ++length;
+  if (character < 0x80) {
+    decoder->codepoint = character;
+    return UTF8_ACCEPT;
   }
 
-  if (length > 4)
-    return 0;
+  if (character < 0xc2)
+    return UTF8_REJECT;
+
+  if (character < 0xe0) {
+    decoder->codepoint = character & 0x1f;
+    decoder->remaining = 1;
+  } else if (character < 0xf0) {
+    if (character == 0xe0)
+      decoder->lower = 0xa0;
+    else if (character == 0xed)
+      decoder->upper = 0x9f;
+
+    decoder->codepoint = character & 0x0f;
+    decoder->remaining = 2;
+  } else if (character < 0xf5) {
+    if (character == 0xf0)
+      decoder->lower = 0x90;
+    else if (character == 0xf4)
+      decoder->upper = 0x8f;
+
+    decoder->codepoint = character & 0x07;
+    decoder->remaining = 3;
+  } else
+    return UTF8_REJECT;
 
-  return length;
+  return UTF8_CONTINUE;
 }
 
-static codepoint_t decode_utf8_codepoint(character_t *buffer, size_t length) {
-  if (!(length > 0 && length <= 3))
-    return 0;
+static enum utf8_step utf8_continue(struct utf8_decoder *decoder,
+                                    character_t character) {
+  if (character < decoder->lower || character > decoder->upper)
+    return UTF8_REJECT;
 
-  size_t shift = utf8_codec[0]->bits_stored * (length - 1);
-  codepoint_t codepoint = (*buffer++ & utf8_codec[length]->mask) << shift;
+  decoder->codepoint = decoder->codepoint << 6 | (character & 0x3f);
+  decoder->lower = 0x80;
+  decoder->upper = 0xbf;
 
-  for (size_t i = 1; i < length; ++i, ++buffer) {
-    shift -= utf8_codec[0]->bits_stored;
-    codepoint |= (*buffer & utf8_codec[0]->mask) << shift;
-  }
+  return --decoder->remaining ? UTF8_CONTINUE : UTF8_ACCEPT;
+}
 
-  return codepoint;
+// There are no glyphs past the BMP, and cells only hold 16 bits.
+static codepoint_t utf8_codepoint(const struct utf8_decoder *decoder) {
+  return decoder->codepoint > 0xffff ? UTF8_REPLACEMENT_CODEPOINT
+                                     : decoder->codepoint;
 }
 
 static codepoint_t transform_codepoint(struct terminal *terminal,
@@ -1353,38 +1404,38 @@ static void receive_one_byte(struct terminal *terminal, character_t character) {
   receive_codepoint(terminal, (codepoint_t)character);
 }
 
-static const receive_table_t utf8_continuation_receive_table;
-
 static void receive_utf8_prefix(struct terminal *terminal,
                                 character_t character) {
-
-  size_t length = get_utf8_codepoint_length(character);
-
-  if (length > 1) {
-    terminal->utf8_codepoint_length = length;
-    terminal->utf8_buffer[terminal->utf8_buffer_length++] = character;
+  switch (utf8_start(&terminal->utf8, character)) {
+  case UTF8_ACCEPT:
+    receive_codepoint(terminal, terminal->utf8.codepoint);
+    break;
+  case UTF8_CONTINUE:
     terminal->receive_table = &utf8_continuation_receive_table;
-  } else if (length == 1)
-    receive_codepoint(terminal, decode_utf8_codepoint(&character, 1));
-}
-
-static void clear_utf8_buffer(struct terminal *terminal) {
-  terminal->utf8_codepoint_length = 0;
-  terminal->utf8_buffer_length = 0;
-  memset(terminal->utf8_buffer, 0, 4);
+    break;
+  case UTF8_REJECT:
+    receive_codepoint(terminal, UTF8_REPLACEMENT_CODEPOINT);
+    break;
+  }
 }
 
 static void receive_utf8_continuation(struct terminal *terminal,
                                       character_t character) {
-
-  terminal->utf8_buffer[terminal->utf8_buffer_length++] = character;
-  if (terminal->utf8_buffer_length == terminal->utf8_codepoint_length) {
-    receive_codepoint(terminal,
-                      decode_utf8_codepoint(terminal->utf8_buffer,
-                                            terminal->utf8_codepoint_length));
-
-    clear_utf8_buffer(terminal);
+  switch (utf8_continue(&terminal->utf8, character)) {
+  case UTF8_ACCEPT:
+    terminal->receive_table = &utf8_prefix_receive_table;
+    receive_codepoint(terminal, utf8_codepoint(&terminal->utf8));
+    break;
+  case UTF8_CONTINUE:
+    break;
+  case UTF8_REJECT:
+    // The cut short sequence stands for one replacement character, and the
+    // byte that ended it, which may be a lead byte, a control or ESC, is
+    // taken afresh.
     terminal->receive_table = &utf8_prefix_receive_table;
+    receive_codepoint(terminal, UTF8_REPLACEMENT_CODEPOINT);
+    terminal_uart_receive_character(terminal, character);
+    break;
   }
 }
 
@@ -1392,7 +1443,8 @@ static void receive_8bit_control(struct terminal *terminal,
                                  character_t character,
                                  character_t control_character) {
   if (terminal->receive_c1_mode == C1_MODE_7BIT) {
-    receive_t receive = (*terminal->receive_table)[DEFAULT_RECEIVE];
+    receive_t receive =
+        receive_handlers[terminal->receive_table->default_action];
     receive(terminal, character);
     return;
   }
@@ -1459,11 +1511,9 @@ static void receive_unexpected(struct terminal *terminal,
 
 void terminal_uart_receive_character(struct terminal *terminal,
                                      character_t character) {
-  receive_t receive = (*terminal->receive_table)[character];
-
-  if (!receive) {
-    receive = (*terminal->receive_table)[DEFAULT_RECEIVE];
-  }
+  receive_t receive =
+      receive_handlers[terminal->receive_table
+                           ->actions[receive_classes[character]]];
 
 #ifdef DEBUG
   // Keep zero for the end of the string for printf
@@ -1484,249 +1534,155 @@ void terminal_uart_receive_character(struct terminal *terminal,
   receive(terminal, character);
 }
 
-void terminal_uart_receive_string(struct terminal *terminal,
-                                  const char *string) {
-  while (*string) {
-    terminal_uart_receive_character(terminal, *string);
-    string++;
-  }
+static bool printable_character(character_t character) {
+  return character >= 0x20 && character < 0x7f;
 }
 
-#define RECEIVE_HANDLER(c, h) [c] = h
-#define DEFAULT_RECEIVE_HANDLER(h) [DEFAULT_RECEIVE] = h
-
-#define DEFAULT_RECEIVE_TABLE                                                  \
-  RECEIVE_HANDLER(0x07, receive_bell), RECEIVE_HANDLER(0x08, receive_bs),      \
-      RECEIVE_HANDLER(0x09, receive_tab), RECEIVE_HANDLER(0x0a, receive_lf),   \
-      RECEIVE_HANDLER(0x0b, receive_lf), RECEIVE_HANDLER(0x0c, receive_lf),    \
-      RECEIVE_HANDLER(0x0d, receive_cr), RECEIVE_HANDLER(0x0e, receive_so),    \
-      RECEIVE_HANDLER(0x0f, receive_si), RECEIVE_HANDLER(0x1a, receive_sub),   \
-      RECEIVE_HANDLER(0x1b, receive_esc), RECEIVE_HANDLER(0x7f, receive_bs),   \
-      RECEIVE_HANDLER(0x84, receive_8bit_ind),                                 \
-      RECEIVE_HANDLER(0x85, receive_8bit_nel),                                 \
-      RECEIVE_HANDLER(0x88, receive_8bit_hts),                                 \
-      RECEIVE_HANDLER(0x8d, receive_8bit_ri),                                  \
-      RECEIVE_HANDLER(0x8e, receive_8bit_ss2),                                 \
-      RECEIVE_HANDLER(0x8f, receive_8bit_ss3),                                 \
-      RECEIVE_HANDLER(0x90, receive_8bit_dcs),                                 \
-      RECEIVE_HANDLER(0x9a, receive_8bit_da),                                  \
-      RECEIVE_HANDLER(0x9b, receive_8bit_csi),                                 \
-      RECEIVE_HANDLER(0x9d, receive_8bit_osc),                                 \
-      RECEIVE_HANDLER(0x9e, receive_8bit_pm),                                  \
-      RECEIVE_HANDLER(0x9f, receive_8bit_apc)
-
-static const receive_table_t one_byte_receive_table = {
-    DEFAULT_RECEIVE_TABLE,
-    DEFAULT_RECEIVE_HANDLER(receive_one_byte),
-};
+// Checks four bytes at once: no high bit, nothing below 0x20 and no 0x7f.
+// Carries and borrows only cross into the next byte once one has failed.
+static bool printable_word(const character_t *characters) {
+  uint32_t word;
+  memcpy(&word, characters, sizeof(word));
 
-static const receive_table_t utf8_prefix_receive_table = {
-    DEFAULT_RECEIVE_TABLE,
-    DEFAULT_RECEIVE_HANDLER(receive_utf8_prefix),
-};
+  return !((word | (word + 0x01010101) | (word - 0x20202020)) & 0x80808080);
+}
 
-static const receive_table_t utf8_continuation_receive_table = {
-    DEFAULT_RECEIVE_HANDLER(receive_utf8_continuation),
-};
+static void receive_codepoints(struct terminal *terminal,
+                               codepoint_t *codepoints, size_t count) {
+  for (size_t i = 0; i < count; ++i)
+    codepoints[i] = transform_codepoint(terminal, codepoints[i]);
 
-static const receive_table_t esc_receive_table = {
-    DEFAULT_RECEIVE_TABLE,
-    RECEIVE_HANDLER(' ', receive_space),
-    RECEIVE_HANDLER('(', receive_scs),
-    RECEIVE_HANDLER(')', receive_scs),
-    RECEIVE_HANDLER('*', receive_scs),
-    RECEIVE_HANDLER('+', receive_scs),
-    RECEIVE_HANDLER('-', receive_scs),
-    RECEIVE_HANDLER('.', receive_scs),
-    RECEIVE_HANDLER('/', receive_scs),
-    RECEIVE_HANDLER('[', receive_csi),
-    RECEIVE_HANDLER(']', receive_osc),
-    RECEIVE_HANDLER('#', receive_hash),
-    RECEIVE_HANDLER('=', receive_deckpam),
-    RECEIVE_HANDLER('>', receive_deckpnm),
-    RECEIVE_HANDLER('_', receive_apc),
-    RECEIVE_HANDLER('^', receive_pm),
-    RECEIVE_HANDLER('%', receive_percent),
-    RECEIVE_HANDLER('c', receive_ris),
-    RECEIVE_HANDLER('n', receive_ls2),
-    RECEIVE_HANDLER('o', receive_ls3),
-    RECEIVE_HANDLER('E', receive_nel),
-    RECEIVE_HANDLER('D', receive_ind),
-    RECEIVE_HANDLER('H', receive_hts),
-    RECEIVE_HANDLER('M', receive_ri),
-    RECEIVE_HANDLER('N', receive_ss2),
-    RECEIVE_HANDLER('O', receive_ss3),
-    RECEIVE_HANDLER('P', receive_dcs),
-    RECEIVE_HANDLER('Z', receive_da),
-    RECEIVE_HANDLER('7', receive_decsc),
-    RECEIVE_HANDLER('8', receive_decrc),
-    DEFAULT_RECEIVE_HANDLER(receive_unexpected),
-};
+  terminal_screen_put_codepoints(terminal, codepoints, count);
+  terminal->prev_codepoint = codepoints[count - 1];
+}
 
-static const receive_table_t vt52_esc_receive_table = {
-    DEFAULT_RECEIVE_TABLE,
-    RECEIVE_HANDLER('A', receive_cuu),
-    RECEIVE_HANDLER('B', receive_cud),
-    RECEIVE_HANDLER('C', receive_cuf),
-    RECEIVE_HANDLER('D', receive_cub),
-    RECEIVE_HANDLER('H', receive_cup),
-    RECEIVE_HANDLER('I', receive_ri),
-    RECEIVE_HANDLER('J', receive_ed),
-    RECEIVE_HANDLER('K', receive_el),
-    RECEIVE_HANDLER('Y', receive_vt52_move_cursor),
-    RECEIVE_HANDLER('Z', receive_vt52_id),
-    RECEIVE_HANDLER('=', receive_deckpam),
-    RECEIVE_HANDLER('>', receive_deckpnm),
-    RECEIVE_HANDLER('<', receive_vt52_ansi),
-    DEFAULT_RECEIVE_HANDLER(receive_unexpected),
-};
+// Takes printable characters, and in UTF-8 whole valid sequences, up to the
+// first byte that needs the receive tables. Returns where that is.
+static const character_t *receive_printable(struct terminal *terminal,
+                                            const character_t *characters,
+                                            const character_t *end,
+                                            bool utf8) {
+  codepoint_t codepoints[PRINTABLE_RUN_LENGTH];
+  size_t count = 0;
 
-static const receive_table_t vt52_move_cursor_row_receive_table = {
-    DEFAULT_RECEIVE_HANDLER(receive_vt52_move_cursor_row),
-};
+  while (characters < end) {
+    if (count > PRINTABLE_RUN_LENGTH - 4) {
+      receive_codepoints(terminal, codepoints, count);
+      count = 0;
+    }
 
-static const receive_table_t vt52_move_cursor_col_receive_table = {
-    DEFAULT_RECEIVE_HANDLER(receive_vt52_move_cursor_col),
-};
+    if (end - characters >= 4 && printable_word(characters)) {
+      for (size_t i = 0; i < 4; ++i)
+        codepoints[count++] = *characters++;
+      continue;
+    }
 
-#define ESC_PARAM_RECEIVE_TABLE                                                \
-  RECEIVE_HANDLER('0', receive_esc_param),                                     \
-      RECEIVE_HANDLER('1', receive_esc_param),                                 \
-      RECEIVE_HANDLER('2', receive_esc_param),                                 \
-      RECEIVE_HANDLER('3', receive_esc_param),                                 \
-      RECEIVE_HANDLER('4', receive_esc_param),                                 \
-      RECEIVE_HANDLER('5', receive_esc_param),                                 \
-      RECEIVE_HANDLER('6', receive_esc_param),                                 \
-      RECEIVE_HANDLER('7', receive_esc_param),                                 \
-      RECEIVE_HANDLER('8', receive_esc_param),                                 \
-      RECEIVE_HANDLER('9', receive_esc_param),                                 \
-      RECEIVE_HANDLER(';', receive_esc_param_delimiter)
-
-static const receive_table_t csi_receive_table = {
-    DEFAULT_RECEIVE_TABLE,
-    ESC_PARAM_RECEIVE_TABLE,
-    RECEIVE_HANDLER('`', receive_hpa),
-    RECEIVE_HANDLER('@', receive_ich),
-    RECEIVE_HANDLER('?', receive_csi_qm),
-    RECEIVE_HANDLER('!', receive_csi_em),
-    RECEIVE_HANDLER('>', receive_csi_gt),
-    RECEIVE_HANDLER('a', receive_hpr),
-    RECEIVE_HANDLER('b', receive_rep),
-    RECEIVE_HANDLER('c', receive_da),
-    RECEIVE_HANDLER('d', receive_vpa),
-    RECEIVE_HANDLER('e', receive_vpr),
-    RECEIVE_HANDLER('f', receive_hvp),
-    RECEIVE_HANDLER('g', receive_tbc),
-    RECEIVE_HANDLER('h', receive_sm),
-    RECEIVE_HANDLER('l', receive_rm),
-    RECEIVE_HANDLER('m', receive_sgr),
-    RECEIVE_HANDLER('n', receive_dsr),
-    RECEIVE_HANDLER('r', receive_decstbm),
-    RECEIVE_HANDLER('x', receive_decreqtparm),
-    RECEIVE_HANDLER('y', receive_dectst),
-    RECEIVE_HANDLER('A', receive_cuu),
-    RECEIVE_HANDLER('B', receive_cud),
-    RECEIVE_HANDLER('C', receive_cuf),
-    RECEIVE_HANDLER('D', receive_cub),
-    RECEIVE_HANDLER('E', receive_cnl),
-    RECEIVE_HANDLER('F', receive_cpl),
-    RECEIVE_HANDLER('G', receive_cha),
-    RECEIVE_HANDLER('H', receive_cup),
-    RECEIVE_HANDLER('I', receive_cht),
-    RECEIVE_HANDLER('J', receive_ed),
-    RECEIVE_HANDLER('K', receive_el),
-    RECEIVE_HANDLER('L', receive_il),
-    RECEIVE_HANDLER('M', receive_dl),
-    RECEIVE_HANDLER('P', receive_dch),
-    RECEIVE_HANDLER('S', receive_su),
-    RECEIVE_HANDLER('T', receive_sd),
-    RECEIVE_HANDLER('X', receive_ech),
-    RECEIVE_HANDLER('Z', receive_cbt),
-    DEFAULT_RECEIVE_HANDLER(receive_unexpected),
-};
+    if (printable_character(*characters)) {
+      codepoints[count++] = *characters++;
+      continue;
+    }
 
-static const receive_table_t csi_qm_receive_table = {
-    DEFAULT_RECEIVE_TABLE,
-    ESC_PARAM_RECEIVE_TABLE,
-    RECEIVE_HANDLER('h', receive_decsm),
-    RECEIVE_HANDLER('l', receive_decrm),
-    DEFAULT_RECEIVE_HANDLER(receive_unexpected),
-};
+    if (!utf8)
+      break;
 
-static const receive_table_t csi_em_receive_table = {
-    DEFAULT_RECEIVE_TABLE,
-    ESC_PARAM_RECEIVE_TABLE,
-    RECEIVE_HANDLER('p', receive_decstr),
-    DEFAULT_RECEIVE_HANDLER(receive_unexpected),
-};
+    // Sequences that are malformed or cut off by the end of the buffer are
+    // left to the decoder in the receive tables.
+    struct utf8_decoder decoder;
+    if (utf8_start(&decoder, *characters) != UTF8_CONTINUE)
+      break;
 
-static const receive_table_t csi_gt_receive_table = {
-    DEFAULT_RECEIVE_TABLE,
-    ESC_PARAM_RECEIVE_TABLE,
-    RECEIVE_HANDLER('c', receive_sec_da),
-    DEFAULT_RECEIVE_HANDLER(receive_unexpected),
-};
+    const character_t *next = characters + 1;
+    enum utf8_step step = UTF8_CONTINUE;
 
-static const receive_table_t esc_hash_receive_table = {
-    DEFAULT_RECEIVE_TABLE,
-    RECEIVE_HANDLER('8', receive_decaln),
-    DEFAULT_RECEIVE_HANDLER(receive_unexpected),
-};
+    while (step == UTF8_CONTINUE && next < end)
+      step = utf8_continue(&decoder, *next++);
 
-static const receive_table_t esc_space_receive_table = {
-    DEFAULT_RECEIVE_TABLE,
-    RECEIVE_HANDLER('F', receive_s7c1t),
-    RECEIVE_HANDLER('G', receive_s8c1t),
-    DEFAULT_RECEIVE_HANDLER(receive_unexpected),
-};
+    if (step != UTF8_ACCEPT)
+      break;
 
-static const receive_table_t scs_receive_table = {
-    DEFAULT_RECEIVE_TABLE,
-    RECEIVE_HANDLER('A', receive_scs_set),
-    RECEIVE_HANDLER('B', receive_scs_set),
-    RECEIVE_HANDLER('0', receive_scs_set),
-    RECEIVE_HANDLER('1', receive_scs_set),
-    RECEIVE_HANDLER('2', receive_scs_set),
-    DEFAULT_RECEIVE_HANDLER(receive_unexpected),
-};
+    codepoints[count++] = utf8_codepoint(&decoder);
+    characters = next;
+  }
 
-static const receive_table_t esc_percent_receive_table = {
-    DEFAULT_RECEIVE_TABLE,
-    RECEIVE_HANDLER('@', receive_charset_iso_8859_1),
-    RECEIVE_HANDLER('G', receive_charset_utf8),
-    DEFAULT_RECEIVE_HANDLER(receive_unexpected),
-};
+  if (count)
+    receive_codepoints(terminal, codepoints, count);
 
-static const receive_table_t dcs_receive_table = {
-    DEFAULT_RECEIVE_HANDLER(receive_dcs_data),
-};
+  return characters;
+}
 
-static const receive_table_t osc_receive_table = {
-    DEFAULT_RECEIVE_HANDLER(receive_osc_data),
-};
+void terminal_uart_receive_buffer(struct terminal *terminal,
+                                  const character_t *characters, size_t size) {
+  const character_t *end = characters + size;
 
-static const receive_table_t apc_receive_table = {
-    DEFAULT_RECEIVE_HANDLER(receive_apc_data),
-};
+  while (characters < end) {
+    bool utf8 = terminal->receive_table == &utf8_prefix_receive_table;
 
-static const receive_table_t pm_receive_table = {
-    DEFAULT_RECEIVE_HANDLER(receive_pm_data),
-};
+    if (utf8 || terminal->receive_table == &one_byte_receive_table) {
+      const character_t *run =
+          receive_printable(terminal, characters, end, utf8);
 
-void terminal_uart_transmit_character(struct terminal *terminal,
-                                      character_t character) {
+      if (run != characters) {
+        characters = run;
+        continue;
+      }
+    }
 
-  character_t *buffer_head =
-      terminal->transmit_buffer + terminal->transmit_buffer_head;
+    terminal_uart_receive_character(terminal, *characters++);
+  }
+}
 
-  buffer_head[0] = character;
-  terminal->transmit_buffer_head++;
+void terminal_uart_receive_string(struct terminal *terminal,
+                                  const char *string) {
+  while (*string) {
+    terminal_uart_receive_character(terminal, *string);
+    string++;
+  }
+}
+
+#ifdef TERMINAL_HOST
+const char *terminal_uart_receive_state(struct terminal *terminal) {
+  for (size_t i = 0;
+       i < sizeof(receive_table_names) / sizeof(receive_table_names[0]); i++)
+    if (receive_table_names[i].table == terminal->receive_table)
+      return receive_table_names[i].name;
+
+  return "unknown";
+}
+#endif
+
+void terminal_response_init(struct terminal_response *response) {
+  response->size = 0;
+  response->overflow = false;
+}
+
+void terminal_response_add_character(struct terminal_response *response,
+                                     character_t character) {
+  if (response->size == TERMINAL_RESPONSE_SIZE) {
+    response->overflow = true;
+    return;
+  }
 
-  if (terminal->transmit_buffer_head == terminal->transmit_buffer_size)
-    terminal->transmit_buffer_head = 0;
+  response->data[response->size++] = character;
+}
 
-  terminal->callbacks->uart_transmit(buffer_head, 1,
-                                     terminal->transmit_buffer_head);
+void terminal_response_add_string(struct terminal_response *response,
+                                  const char *string) {
+  while (*string)
+    terminal_response_add_character(response, *(string++));
+}
+
+void terminal_response_add_number(struct terminal_response *response,
+                                  unsigned int number) {
+  character_t digits[10];
+  size_t count = 0;
+
+  do {
+    digits[count++] = '0' + number % 10;
+    number /= 10;
+  } while (number);
+
+  while (count)
+    terminal_response_add_character(response, digits[--count]);
 }
 
 static const character_t
@@ -1737,66 +1693,67 @@ static const character_t
         ['\\'] = 0x9c, [']'] = 0x9d, ['^'] = 0x9e, ['_'] = 0x9f,
 };
 
-void terminal_uart_transmit_string(struct terminal *terminal,
-                                   const char *string) {
+bool terminal_uart_transmit_response(struct terminal *terminal,
+                                     const struct terminal_response *response) {
+  if (response->overflow)
+    return false;
+
+  if (terminal->transmit_c1_mode != C1_MODE_8BIT)
+    return terminal->callbacks->uart_transmit(response->data, response->size);
 
-  character_t *buffer_head =
-      terminal->transmit_buffer + terminal->transmit_buffer_head;
+  character_t characters[TERMINAL_RESPONSE_SIZE];
   size_t size = 0;
 
-  while (*string) {
-    if (terminal->transmit_c1_mode == C1_MODE_8BIT && *string == 0x1b) {
-      const char *next = string + 1;
-      character_t eight_bit_character =
-          eight_bit_character_table[(size_t)*next];
-
-      if (eight_bit_character) {
-        buffer_head[size] = eight_bit_character;
-        string += 2;
-      } else {
-        buffer_head[size] = *string;
-        string++;
-      }
+  for (size_t i = 0; i < response->size; i++) {
+    character_t eight_bit_character =
+        response->data[i] == 0x1b && i + 1 < response->size
+            ? eight_bit_character_table[response->data[i + 1]]
+            : 0;
+
+    if (eight_bit_character) {
+      characters[size++] = eight_bit_character;
+      i++;
     } else {
-      buffer_head[size] = *string;
-      string++;
+      characters[size++] = response->data[i];
     }
+  }
 
-    size++;
-    terminal->transmit_buffer_head++;
+  return terminal->callbacks->uart_transmit(characters, size);
+}
 
-    if (terminal->transmit_buffer_head == terminal->transmit_buffer_size) {
-      terminal->transmit_buffer_head = 0;
+bool terminal_uart_transmit_character(struct terminal *terminal,
+                                      character_t character) {
+  return terminal->callbacks->uart_transmit(&character, 1);
+}
 
-      terminal->callbacks->uart_transmit(buffer_head, size,
-                                         terminal->transmit_buffer_head);
+bool terminal_uart_transmit_string(struct terminal *terminal,
+                                   const char *string) {
+  struct terminal_response response;
 
-      buffer_head = terminal->transmit_buffer;
-      size = 0;
-    }
-  }
+  terminal_response_init(&response);
+  terminal_response_add_string(&response, string);
 
-  if (size)
-    terminal->callbacks->uart_transmit(buffer_head, size,
-                                       terminal->transmit_buffer_head);
+  return terminal_uart_transmit_response(terminal, &response);
 }
 
-void terminal_uart_transmit_printf(struct terminal *terminal,
-                                   const char *format, ...) {
-  va_list args;
-  va_start(args, format);
+bool terminal_uart_transmit_flow_character(struct terminal *terminal,
+                                           character_t character) {
+  if (terminal->callbacks->uart_transmit_flow)
+    return terminal->callbacks->uart_transmit_flow(character);
 
-  char buffer[PRINTF_BUFFER_SIZE];
-  vsnprintf(buffer, PRINTF_BUFFER_SIZE, format, args);
-  terminal_uart_transmit_string(terminal, buffer);
-
-  va_end(args);
+  return terminal_uart_transmit_character(terminal, character);
 }
 
 void terminal_uart_xon_off(struct terminal *terminal, enum xon_off xon_off) {
   if (!terminal->lock_state.scroll && terminal->xon_off != xon_off) {
-    terminal_uart_transmit_character(terminal,
-                                     xon_off == XOFF ? CHAR_XOFF : CHAR_XON);
+    if (terminal->flow_control == FLOW_CONTROL_RTS_CTS)
+      terminal->callbacks->uart_set_rts(xon_off == XON);
+    // The state is left alone if the character could not be sent, so that
+    // the next flow control check sends it again.
+    else if (!terminal_uart_transmit_flow_character(
+                 terminal, xon_off == XOFF ? CHAR_XOFF : CHAR_XON))
+      return;
+
     terminal->xon_off = xon_off;
 #ifdef DEBUG_LOG_XON_OFF
     printf(xon_off == XOFF ? "XOFF\r\n" : "XON\r\n");
@@ -1804,17 +1761,85 @@ void terminal_uart_xon_off(struct terminal *terminal, enum xon_off xon_off) {
   }
 }
 
+// Stops the host while there is still room for everything it sends before it
+// notices, less what is drained meanwhile, and restarts it while the backlog
+// still covers the time it takes to resume. Half the measured drain rate is
+// counted on, as rendering slows down whenever a lot has to scroll.
+static void update_flow_limits(struct terminal *terminal) {
+  uint64_t latency_us = terminal->flow_control == FLOW_CONTROL_RTS_CTS
+                            ? RTS_LATENCY_US
+                            : XOFF_LATENCY_US;
+  uint32_t line_rate = terminal->baud_rate / 10;
+  uint32_t drain_rate = terminal->consume_rate / 2;
+
+  if (drain_rate > line_rate)
+    drain_rate = line_rate;
+
+  size_t headroom =
+      (line_rate - drain_rate) * latency_us / 1000000 + FLOW_SLACK;
+  size_t lead = terminal->consume_rate * latency_us / 1000000 + FLOW_SLACK;
+
+  if (headroom > terminal->receive_buffer_size / 2)
+    headroom = terminal->receive_buffer_size / 2;
+
+  terminal->xoff_limit = terminal->receive_buffer_size - headroom;
+  terminal->xon_limit =
+      lead < terminal->xoff_limit / 2 ? lead : terminal->xoff_limit / 2;
+}
+
+// Takes the drain rate from how much the receive size went down between calls
+// over a window, provided the buffer never ran dry in it.
+static void measure_consume_rate(struct terminal *terminal,
+                                 size_t receive_size) {
+  if (receive_size < terminal->flow_last_size)
+    terminal->flow_window_consumed += terminal->flow_last_size - receive_size;
+
+  if (!receive_size)
+    terminal->flow_window_backlogged = false;
+
+  terminal->flow_last_size = receive_size;
+
+  uint32_t ticks = terminal->flow_ticks - terminal->flow_window_start;
+  if (ticks < FLOW_WINDOW_TICKS)
+    return;
+
+  if (terminal->flow_window_backlogged) {
+    uint32_t rate = terminal->flow_window_consumed * 1000 / ticks;
+
+    terminal->consume_rate = terminal->consume_rate
+                                 ? (3 * terminal->consume_rate + rate) / 4
+                                 : rate;
+    update_flow_limits(terminal);
+  }
+
+  terminal->flow_window_start += ticks;
+  terminal->flow_window_consumed = 0;
+  terminal->flow_window_backlogged = true;
+}
+
 void terminal_uart_flow_control(struct terminal *terminal,
                                 size_t receive_size) {
-  if (terminal->flow_control) {
-    if (receive_size > XOFF_LIMIT)
-      terminal_uart_xon_off(terminal, XOFF);
+  terminal->jump_scroll_backlog = receive_size > JUMP_SCROLL_BACKLOG;
+
+  if (terminal->flow_control == FLOW_CONTROL_NONE)
+    return;
 
-    if (receive_size < XON_LIMIT)
-      terminal_uart_xon_off(terminal, XON);
+  measure_consume_rate(terminal, receive_size);
+
+  if (terminal->xon_off == XON) {
+    if (receive_size > terminal->xoff_limit)
+      terminal_uart_xon_off(terminal, XOFF);
+  } else if (receive_size < terminal->xon_limit) {
+    terminal_uart_xon_off(terminal, XON);
   }
 }
 
+void terminal_uart_set_receive_buffer_size(struct terminal *terminal,
+                                           size_t size) {
+  terminal->receive_buffer_size = size;
+  update_flow_limits(terminal);
+}
+
 void terminal_uart_init(struct terminal *terminal) {
   if (terminal->charset == CHARSET_UTF8)
     terminal->receive_table = &utf8_prefix_receive_table;
@@ -1822,7 +1847,7 @@ void terminal_uart_init(struct terminal *terminal) {
     terminal->receive_table = &one_byte_receive_table;
 
   clear_esc_params(terminal);
-  clear_utf8_buffer(terminal);
+  terminal->utf8 = (struct utf8_decoder){0};
   clear_control_data(&terminal->dcs);
   clear_control_data(&terminal->osc);
   clear_control_data(&terminal->apc);
@@ -1833,6 +1858,13 @@ void terminal_uart_init(struct terminal *terminal) {
   terminal->gset_received = GSET_UNDEFINED;
   terminal->xon_off = XON;
 
+  terminal->consume_rate = 0;
+  terminal->flow_window_start = terminal->flow_ticks;
+  terminal->flow_window_consumed = 0;
+  terminal->flow_window_backlogged = true;
+  terminal->flow_last_size = 0;
+  update_flow_limits(terminal);
+
   terminal->vs.gset_gl = GSET_G0;
   memset(terminal->vs.gset_table, 0,
          GSET_MAX * sizeof(codepoint_transformation_table_t *));